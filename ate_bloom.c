@@ -0,0 +1,89 @@
+/**
+ * @file ate_bloom.c
+ * @brief Bloom filter of the values of a key
+ */
+
+#include "ate_bloom.h"
+#include "ate_hash.h"
+
+#include <string.h>
+
+/**
+ * @brief Number of 64-bit words for the bits of @p key_count keys
+ */
+static uint32_t bloom_word_count(int key_count, int bits_per_key)
+{
+   uint64_t bits = (uint64_t)(key_count > 0 ? key_count : 1) * bits_per_key;
+   return (uint32_t)((bits + 63) / 64);
+}
+
+/**
+ * @brief Number of bytes needed for a Bloom filter
+ * @param "key_count"    number of values to be added
+ * @param "bits_per_key" bits of the filter for each value
+ */
+size_t bloom_filter_size(int key_count, int bits_per_key)
+{
+   return sizeof(BLOOM) + bloom_word_count(key_count, bits_per_key) * sizeof(uint64_t);
+}
+
+/**
+ * @brief Prepare an empty Bloom filter in memory of at least
+ *        `bloom_filter_size(key_count, bits_per_key)` bytes
+ *
+ * The number of bits set for each value, about 0.69 times
+ * @p bits_per_key, gives the fewest false positives for the size.
+ */
+void bloom_filter_init(BLOOM *bloom, int key_count, int bits_per_key)
+{
+   bloom->word_count = bloom_word_count(key_count, bits_per_key);
+   bloom->bits_per_key = bits_per_key;
+   bloom->hash_count = (bits_per_key * 69 + 50) / 100;
+   if (bloom->hash_count < 1)
+      bloom->hash_count = 1;
+   else if (bloom->hash_count > 16)
+      bloom->hash_count = 16;
+
+   memset(bloom->words, 0, bloom->word_count * sizeof(uint64_t));
+}
+
+/**
+ * @brief Set the bits of a value.
+ *
+ * The bits are derived from two halves of one hash value
+ * (double hashing), so each value is only hashed once.
+ */
+void bloom_filter_add(BLOOM *bloom, const char *value)
+{
+   uint64_t hash = hash_string64(value);
+   uint32_t step = (uint32_t)(hash >> 32) | 1;
+   uint32_t bit = (uint32_t)hash;
+   uint64_t bit_count = (uint64_t)bloom->word_count * 64;
+
+   for (int i=0; i < bloom->hash_count; ++i, bit += step)
+   {
+      uint64_t index = bit % bit_count;
+      bloom->words[index / 64] |= (uint64_t)1 << (index % 64);
+   }
+}
+
+/**
+ * @brief Test if a value may have been added to the filter
+ * @return False if the value was certainly not added
+ */
+bool bloom_filter_test(const BLOOM *bloom, const char *value)
+{
+   uint64_t hash = hash_string64(value);
+   uint32_t step = (uint32_t)(hash >> 32) | 1;
+   uint32_t bit = (uint32_t)hash;
+   uint64_t bit_count = (uint64_t)bloom->word_count * 64;
+
+   for (int i=0; i < bloom->hash_count; ++i, bit += step)
+   {
+      uint64_t index = bit % bit_count;
+      if (!(bloom->words[index / 64] & ((uint64_t)1 << (index % 64))))
+         return False;
+   }
+
+   return True;
+}
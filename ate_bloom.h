@@ -0,0 +1,36 @@
+#ifndef ATE_BLOOM_H
+#define ATE_BLOOM_H
+
+#include "ate_handle.h"
+
+#include <stdint.h>
+
+/**
+ * @defgroup ATE_BLOOM Bloom Filter Support
+ *
+ * A Bloom filter of the values of a key, kept in the memory block of
+ * the key handle with its sort order (see ate_sort.h), so that a
+ * search for a value that is not in the key can fail without
+ * comparing any keys.  The filter can report a value that is not in
+ * the key, but never misses one that is.
+ * @{
+ */
+
+/**
+ * @brief Bit array and hashing parameters of a Bloom filter
+ */
+typedef struct bloom_filter {
+   uint32_t word_count;    ///< number of 64-bit words in @p words
+   int      hash_count;    ///< number of bits set for each value
+   int      bits_per_key;  ///< bits per key requested for the filter
+   uint64_t words[];       ///< beginning of the bit array
+} BLOOM;
+
+size_t bloom_filter_size(int key_count, int bits_per_key);
+void bloom_filter_init(BLOOM *bloom, int key_count, int bits_per_key);
+void bloom_filter_add(BLOOM *bloom, const char *value);
+bool bloom_filter_test(const BLOOM *bloom, const char *value);
+
+/** @} */
+
+#endif
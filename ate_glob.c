@@ -0,0 +1,222 @@
+/**
+ * @file ate_glob.c
+ * @brief Index of the glob patterns of a table column
+ */
+
+#include "ate_glob.h"
+#include "ate_hash.h"
+#include "ate_utilities.h"
+
+#include <string.h>
+
+// Declared in Bash's lib/glob/strmatch.h, which is not installed
+// with the builtin headers:
+extern int strmatch(char *pattern, char *string, int flags);
+
+#ifndef FNM_EXTMATCH
+#define FNM_EXTMATCH (1 << 5)
+#endif
+
+/**
+ * @brief 32-bit FNV-1a hash of a string, seeded with the kind of
+ *        pattern so a literal and an equal suffix hash differently
+ */
+static uint32_t glob_hash(const char *str, GLOB_KIND kind)
+{
+   return hash_add_string((HASH_FNV_OFFSET ^ (uint32_t)kind) * HASH_FNV_PRIME, str);
+}
+
+/**
+ * @brief Test for an extended pattern operator, like `+(` or `!(`
+ */
+static bool glob_has_extmatch(const char *pattern)
+{
+   for (const char *paren = strchr(pattern, '('); paren; paren = strchr(paren + 1, '('))
+      if (paren > pattern && strchr("+@!*?", paren[-1]))
+         return True;
+
+   return False;
+}
+
+/**
+ * @brief Classify a pattern by how it can be indexed
+ */
+static GLOB_KIND glob_kind(const char *pattern)
+{
+   if (glob_has_extmatch(pattern))
+      return GLOB_COMPLEX;
+
+   const char *literal = pattern;
+   if (*literal == '*')
+      ++literal;
+
+   if (literal[strcspn(literal, "*?[\\")])
+      return GLOB_COMPLEX;
+
+   return literal == pattern ? GLOB_LITERAL : GLOB_SUFFIX;
+}
+
+/**
+ * @brief Literal part of an indexed pattern, without a leading `*`
+ */
+static const char *glob_literal(const AHEAD *head, int row)
+{
+   const GINDEX *gindex = head->glob;
+   const char *pattern = get_row_field(head->rows[row], gindex->column);
+   return gindex->kinds[row] == GLOB_SUFFIX ? pattern + 1 : pattern;
+}
+
+/**
+ * @brief Find the slot holding the literal @p str of @p kind, or the
+ *        empty slot where it would be placed.
+ */
+static uint32_t glob_probe(const AHEAD *head, const char *str, GLOB_KIND kind)
+{
+   const GINDEX *gindex = head->glob;
+   uint32_t slot = glob_hash(str, kind) & gindex->mask;
+
+   int32_t row;
+   while ((row = gindex->slots[slot]) >= 0)
+   {
+      if (gindex->kinds[row] == kind && 0 == strcmp(glob_literal(head, row), str))
+         break;
+
+      slot = (slot + 1) & gindex->mask;
+   }
+
+   return slot;
+}
+
+/**
+ * @brief Add a literal length to the ascending list of distinct lengths
+ */
+static void glob_add_length(GINDEX *gindex, int32_t length)
+{
+   int i = gindex->length_count;
+   while (i > 0 && gindex->lengths[i-1] > length)
+      --i;
+
+   if (i > 0 && gindex->lengths[i-1] == length)
+      return;
+
+   memmove(&gindex->lengths[i+1], &gindex->lengths[i],
+           (gindex->length_count - i) * sizeof(int32_t));
+   gindex->lengths[i] = length;
+   ++gindex->length_count;
+}
+
+/**
+ * @brief Number of bytes needed for the glob index of @p row_count rows,
+ *        to be added to `ate_calculate_head_size(row_count)`
+ */
+size_t glob_index_size(int row_count)
+{
+   return sizeof(GINDEX)
+      + (size_t)row_count * (2 * sizeof(int32_t) + sizeof(uint8_t))
+      + hash_slot_count(row_count) * sizeof(int32_t);
+}
+
+/**
+ * @brief Build the glob index of a column in the unused end of a
+ *        head's memory block.
+ *
+ * The head must have been allocated with at least
+ * `ate_calculate_head_size(head->row_count) + glob_index_size(head->row_count)`
+ * bytes, and its rows must be set.
+ *
+ * Of rows with equal indexed patterns, only the first is indexed,
+ * because a later row can never be the first match.
+ *
+ * @param "head"    [in,out] head whose rows are to be indexed
+ * @param "column"  [in]     index of the pattern field
+ */
+void glob_index_build(AHEAD *head, int column)
+{
+   int row_count = head->row_count;
+   uint32_t slot_count = hash_slot_count(row_count);
+
+   GINDEX *gindex = (GINDEX*)&head->rows[row_count];
+   gindex->column = column;
+   gindex->mask = slot_count - 1;
+   gindex->length_count = 0;
+   gindex->complex_count = 0;
+   gindex->lengths = (int32_t*)&gindex[1];
+   gindex->complex_rows = &gindex->lengths[row_count];
+   gindex->slots = &gindex->complex_rows[row_count];
+   gindex->kinds = (uint8_t*)&gindex->slots[slot_count];
+
+   memset(gindex->slots, -1, slot_count * sizeof(int32_t));
+   head->glob = gindex;
+
+   for (int row = 0; row < row_count; ++row)
+   {
+      GLOB_KIND kind = glob_kind(get_row_field(head->rows[row], column));
+      gindex->kinds[row] = (uint8_t)kind;
+
+      if (kind == GLOB_COMPLEX)
+         gindex->complex_rows[gindex->complex_count++] = row;
+      else
+      {
+         const char *literal = glob_literal(head, row);
+         uint32_t slot = glob_probe(head, literal, kind);
+         if (gindex->slots[slot] < 0)
+         {
+            gindex->slots[slot] = row;
+            glob_add_length(gindex, (int32_t)strlen(literal));
+         }
+      }
+   }
+}
+
+/**
+ * @brief Find the first row whose pattern matches @p str
+ *
+ * Each distinct literal length is tried once, by looking up the end
+ * of @p str with that length.  Complex patterns are then matched in
+ * table order, but only those in rows before the best indexed match.
+ *
+ * @param "head"  [in] head with a glob index
+ * @param "str"   [in] string to match
+ * @return row index, or -1 if no pattern matches
+ */
+int glob_index_match(const AHEAD *head, const char *str)
+{
+   const GINDEX *gindex = head->glob;
+   size_t str_len = strlen(str);
+   int best = -1;
+
+   for (int i=0; i < gindex->length_count; ++i)
+   {
+      size_t length = (size_t)gindex->lengths[i];
+      if (length > str_len)
+         break;
+
+      const char *end = str + str_len - length;
+      int row = gindex->slots[glob_probe(head, end, GLOB_SUFFIX)];
+      if (row >= 0 && (best < 0 || row < best))
+         best = row;
+
+      if (end == str)
+      {
+         row = gindex->slots[glob_probe(head, str, GLOB_LITERAL)];
+         if (row >= 0 && (best < 0 || row < best))
+            best = row;
+      }
+   }
+
+   for (int i=0; i < gindex->complex_count; ++i)
+   {
+      int row = gindex->complex_rows[i];
+      if (best >= 0 && row > best)
+         break;
+
+      char *pattern = (char*)get_row_field(head->rows[row], gindex->column);
+      if (0 == strmatch(pattern, (char*)str, FNM_EXTMATCH))
+      {
+         best = row;
+         break;
+      }
+   }
+
+   return best;
+}
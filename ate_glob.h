@@ -0,0 +1,55 @@
+#ifndef ATE_GLOB_H
+#define ATE_GLOB_H
+
+#include <builtins.h>
+// Prevent multiple inclusion of shell.h:
+#ifndef EXECUTION_FAILURE
+#include <shell.h>
+#endif
+
+#include "ate_handle.h"
+
+#include <stdint.h>
+
+/**
+ * @defgroup ATE_GLOB Glob Pattern Index Support
+ *
+ * Resources for finding the first row whose glob pattern matches a
+ * string.  Patterns without wildcards, and `*` followed by a literal
+ * suffix, like `*.txt`, are found by hashing the ends of the string.
+ * Only the remaining patterns are matched one by one.  The index is
+ * kept in the memory block of a handle after its last row pointer,
+ * so it is released with the handle.
+ * @{
+ */
+
+/**
+ * @brief How a glob pattern is indexed
+ */
+typedef enum {
+   GLOB_LITERAL = 0,   ///< no wildcards, matches only itself
+   GLOB_SUFFIX,        ///< `*` followed by a literal suffix
+   GLOB_COMPLEX        ///< any other pattern, matched with strmatch
+} GLOB_KIND;
+
+/**
+ * @brief Glob pattern index of the rows of a `make_glob_index` handle
+ */
+typedef struct glob_index {
+   int      column;        ///< index of the pattern field in a row
+   uint32_t mask;          ///< number of @p slots minus one (a power of two)
+   int      length_count;  ///< number of distinct literal lengths
+   int      complex_count; ///< number of rows with complex patterns
+   int32_t  *lengths;      ///< distinct literal lengths, ascending
+   int32_t  *complex_rows; ///< rows with complex patterns, in table order
+   int32_t  *slots;        ///< first row of each literal, or -1 if empty
+   uint8_t  *kinds;        ///< GLOB_KIND of each row
+} GINDEX;
+
+size_t glob_index_size(int row_count);
+void glob_index_build(AHEAD *head, int column);
+int glob_index_match(const AHEAD *head, const char *str);
+
+/** @} */
+
+#endif
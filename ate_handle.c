@@ -45,6 +45,33 @@ size_t ate_calculate_head_size(int row_count)
       return sizeof(AHEAD);
 }
 
+/**
+ * @brief Memory needed for a native key head, whose source row
+ *        indexes follow its row pointers
+ * @param "row_count"  number of key rows
+ * @return Number of bytes, rounded up to keep what follows aligned
+ */
+size_t ate_calculate_native_key_size(int row_count)
+{
+   size_t size = ate_calculate_head_size(row_count);
+   if (row_count > 0)
+      size += (size_t)row_count * sizeof(int32_t);
+
+   return (size + sizeof(int64_t) - 1) / sizeof(int64_t) * sizeof(int64_t);
+}
+
+/**
+ * @brief Offset of the first byte after the rows of a head, where a
+ *        sort order, hash index or glob index may be kept
+ */
+size_t ate_head_annex_offset(const AHEAD *head)
+{
+   if (head->key_rows)
+      return ate_calculate_native_key_size(head->row_count);
+   else
+      return ate_calculate_head_size(head->row_count);
+}
+
 /**
  * @brief Convenient dereferencing to access element count;
  * @param "head"   Handle to initialized AHEAD
@@ -427,8 +454,9 @@ int ate_check_head_integrity(AHEAD *head)
    int element_count = array->num_elements;
 
    // Two orphans tests:
-   // Test incomplete row orphans:
-   if (element_count % head->row_size)
+   // Test incomplete row orphans, except for a native key, whose
+   // rows are fields of the rows of its array:
+   if (head->key_rows == NULL && element_count % head->row_size)
    {
       ate_register_error("head incompatible row size (%d) for %d array elements",
                          head->row_size, element_count);
@@ -2,6 +2,7 @@
 #define ATE_HANDLE_H
 
 #include <builtins.h>
+#include <stdint.h>
 
 // Prevent multiple inclusion of shell.h:
 #ifndef EXECUTION_FAILURE
@@ -25,6 +26,10 @@ typedef enum {
    True
 } bool;
 
+struct sort_order;
+struct hash_index;
+struct glob_index;
+
 /**
  * @brief working details of a table extension to a Bash ARRAY
  *
@@ -39,6 +44,11 @@ typedef struct ate_head {
    SHELL_VAR *array;       ///< array to which @p row elements will point
    int row_size;           ///< number of elements in a row
    int row_count;          ///< number of @p rows elements in structure
+   struct sort_order *order; ///< how @p rows were ordered, if recorded (see ate_sort.h)
+   struct hash_index *hash;  ///< hash index of a column, if made (see ate_hash.h)
+   struct glob_index *glob;  ///< glob pattern index of a column, if made (see ate_glob.h)
+   int32_t *key_rows;      ///< source row index of each row of a native key
+                           ///< (make_key -n), follows @p rows, or NULL
    ARRAY_ELEMENT *rows[];  ///< beginning of array of pointers
 } AHEAD;
 
@@ -67,6 +77,8 @@ bool ahead_p(const SHELL_VAR *var);
  * @{
  */
 size_t ate_calculate_head_size(int row_count);
+size_t ate_calculate_native_key_size(int row_count);
+size_t ate_head_annex_offset(const AHEAD *head);
 int ate_get_element_count(const AHEAD *head);
 /** @} */
 
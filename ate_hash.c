@@ -0,0 +1,166 @@
+/**
+ * @file ate_hash.c
+ * @brief Open-addressing hash index of a table column
+ */
+
+#include "ate_hash.h"
+#include "ate_utilities.h"
+
+#include <string.h>
+
+/**
+ * @brief Continue a 32-bit FNV-1a hash with the bytes of a string
+ * @param "hash"  [in] @ref HASH_FNV_OFFSET to start a new hash, or the
+ *                     hash so far
+ * @param "str"   [in] string whose bytes are added to the hash
+ */
+uint32_t hash_add_string(uint32_t hash, const char *str)
+{
+   while (*str)
+   {
+      hash ^= (unsigned char)*str++;
+      hash *= HASH_FNV_PRIME;
+   }
+   return hash;
+}
+
+/**
+ * @brief 32-bit FNV-1a hash of a string
+ */
+uint32_t hash_string(const char *str)
+{
+   return hash_add_string(HASH_FNV_OFFSET, str);
+}
+
+/**
+ * @brief Continue a hash of several values with one more value
+ *
+ * The zero byte that ends the value is hashed too, so values can't
+ * run together: "ab" and "" hash differently than "a" and "b".
+ *
+ * @param "hash"   [in] @ref HASH_FNV_OFFSET for the first value, or
+ *                      the hash of the preceding values
+ * @param "value"  [in] value to add to the hash
+ */
+uint32_t hash_add_value(uint32_t hash, const char *value)
+{
+   return hash_add_string(hash, value) * HASH_FNV_PRIME;
+}
+
+/**
+ * @brief 64-bit FNV-1a hash of a string
+ */
+uint64_t hash_string64(const char *str)
+{
+   uint64_t hash = 14695981039346656037ull;
+   while (*str)
+   {
+      hash ^= (unsigned char)*str++;
+      hash *= 1099511628211ull;
+   }
+   return hash;
+}
+
+/**
+ * @brief Number of slots for an open-addressing table of @p count
+ *        entries, a power of two that keeps the table at most half full
+ */
+uint32_t hash_slot_count(int count)
+{
+   uint32_t slots = 8;
+   while (slots < (uint32_t)count * 2)
+      slots <<= 1;
+   return slots;
+}
+
+/**
+ * @brief Find the slot holding @p value, or the empty slot where it
+ *        would be placed.
+ */
+static uint32_t hash_probe(const AHEAD *head, uint32_t hash, const char *value)
+{
+   const HINDEX *hindex = head->hash;
+   uint32_t slot = hash & hindex->mask;
+
+   int32_t row;
+   while ((row = hindex->slots[slot]) >= 0)
+   {
+      if (hindex->hashes[row] == hash
+          && 0 == strcmp(get_row_field(head->rows[row], hindex->column), value))
+         break;
+
+      slot = (slot + 1) & hindex->mask;
+   }
+
+   return slot;
+}
+
+/**
+ * @brief Number of bytes needed for the hash index of @p row_count rows,
+ *        to be added to `ate_calculate_head_size(row_count)`
+ */
+size_t hash_index_size(int row_count)
+{
+   return sizeof(HINDEX)
+      + (size_t)row_count * (sizeof(uint32_t) + sizeof(int32_t))
+      + hash_slot_count(row_count) * sizeof(int32_t);
+}
+
+/**
+ * @brief Build the hash index of a column in the unused end of a
+ *        head's memory block.
+ *
+ * The head must have been allocated with at least
+ * `ate_calculate_head_size(head->row_count) + hash_index_size(head->row_count)`
+ * bytes, and its rows must be set.
+ *
+ * @param "head"    [in,out] head whose rows are to be indexed
+ * @param "column"  [in]     index of the field to hash
+ */
+void hash_index_build(AHEAD *head, int column)
+{
+   int row_count = head->row_count;
+   uint32_t slot_count = hash_slot_count(row_count);
+
+   HINDEX *hindex = (HINDEX*)&head->rows[row_count];
+   hindex->column = column;
+   hindex->mask = slot_count - 1;
+   hindex->hashes = (uint32_t*)&hindex[1];
+   hindex->next = (int32_t*)&hindex->hashes[row_count];
+   hindex->slots = &hindex->next[row_count];
+
+   memset(hindex->slots, -1, slot_count * sizeof(int32_t));
+   head->hash = hindex;
+
+   // Rows are added last to first, each to the front of the chain
+   // of its key, so the chains are in table order.
+   for (int row = row_count - 1; row >= 0; --row)
+   {
+      const char *value = get_row_field(head->rows[row], column);
+      uint32_t hash = hash_string(value);
+      hindex->hashes[row] = hash;
+
+      uint32_t slot = hash_probe(head, hash, value);
+      hindex->next[row] = hindex->slots[slot];
+      hindex->slots[slot] = row;
+   }
+}
+
+/**
+ * @brief Find the first row whose key equals @p value
+ * @param "head"   [in] head with a hash index
+ * @param "value"  [in] key value to find
+ * @return row index, or -1 if no row has the key
+ */
+int hash_index_find(const AHEAD *head, const char *value)
+{
+   return head->hash->slots[hash_probe(head, hash_string(value), value)];
+}
+
+/**
+ * @brief Return the next row with the same key as @p row, or -1
+ */
+int hash_index_next(const AHEAD *head, int row)
+{
+   return head->hash->next[row];
+}
@@ -0,0 +1,59 @@
+#ifndef ATE_HASH_H
+#define ATE_HASH_H
+
+#include <builtins.h>
+// Prevent multiple inclusion of shell.h:
+#ifndef EXECUTION_FAILURE
+#include <shell.h>
+#endif
+
+#include "ate_handle.h"
+
+#include <stdint.h>
+
+/**
+ * @defgroup ATE_HASH Hash Index Support
+ *
+ * Resources for exact-match lookups of a column value.  The hash
+ * index is an open-addressing table of row indexes, kept in the
+ * memory block of a handle after its last row pointer, so it is
+ * released with the handle.  Rows with equal keys are linked in
+ * table order through a chain of row indexes.
+ *
+ * The string hashes and the slot count are shared with the other
+ * hash tables: those of `join`, `aggregate`, `distinct`, the glob
+ * index and the Bloom filter of a key.
+ * @{
+ */
+
+/**
+ * @brief Hash table of the rows of a `make_hash` handle
+ */
+typedef struct hash_index {
+   int      column;     ///< index of the hashed field in a row
+   uint32_t mask;       ///< number of @p slots minus one (a power of two)
+   uint32_t *hashes;    ///< hash value of each row's key
+   int32_t  *next;      ///< next row with the same key, or -1
+   int32_t  *slots;     ///< first row of each distinct key, or -1 if empty
+} HINDEX;
+
+/**
+ * @brief Offset basis and prime of the 32-bit FNV-1a hash
+ */
+#define HASH_FNV_OFFSET 2166136261u
+#define HASH_FNV_PRIME  16777619u
+
+uint32_t hash_add_string(uint32_t hash, const char *str);
+uint32_t hash_string(const char *str);
+uint32_t hash_add_value(uint32_t hash, const char *value);
+uint64_t hash_string64(const char *str);
+uint32_t hash_slot_count(int count);
+
+size_t hash_index_size(int row_count);
+void hash_index_build(AHEAD *head, int column);
+int hash_index_find(const AHEAD *head, const char *value);
+int hash_index_next(const AHEAD *head, int row);
+
+/** @} */
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file ate_radix_sort.c
+ * @brief LSD radix sort for rows with 64-bit integer keys
+ */
+
+#include "ate_sort.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+/**
+ * @brief Map a signed key to an unsigned value with the same order.
+ *
+ * Flipping the sign bit puts negative values before positive values.
+ * For a descending sort, every bit is flipped to invert the order.
+ */
+static inline uint64_t radix_sortable(int64_t key, bool descending)
+{
+   uint64_t ukey = (uint64_t)key ^ ((uint64_t)1 << 63);
+   return descending ? ~ukey : ukey;
+}
+
+/**
+ * @brief Stable least-significant-digit radix sort of integer key records
+ *
+ * All byte histograms are collected in a single pass, then the
+ * records are distributed once for each byte position.  Byte
+ * positions where every key has the same value are skipped, so
+ * small or clustered keys need fewer passes.
+ *
+ * @param "records"    [in,out] records to sort by IKREC::key
+ * @param "count"      [in]     number of records
+ * @param "descending" [in]     True to sort from largest to smallest key
+ * @return True if sorted, False if scratch memory was unavailable
+ */
+bool ate_radix_sort(IKREC *records, int count, bool descending)
+{
+   if (count < 2)
+      return True;
+
+   size_t (*histograms)[RADIX_BUCKETS] =
+      (size_t(*)[RADIX_BUCKETS])xmalloc(RADIX_PASSES * sizeof(*histograms));
+   IKREC *scratch = (IKREC*)xmalloc(count * sizeof(IKREC));
+   if (histograms == NULL || scratch == NULL)
+   {
+      if (histograms)
+         xfree(histograms);
+      if (scratch)
+         xfree(scratch);
+      return False;
+   }
+
+   memset(histograms, 0, RADIX_PASSES * sizeof(*histograms));
+
+   IKREC *rec = records;
+   IKREC *rec_end = rec + count;
+   while (rec < rec_end)
+   {
+      uint64_t ukey = radix_sortable(rec->key, descending);
+      for (int pass=0; pass < RADIX_PASSES; ++pass)
+      {
+         ++histograms[pass][ukey & (RADIX_BUCKETS-1)];
+         ukey >>= RADIX_BITS;
+      }
+      ++rec;
+   }
+
+   IKREC *source = records;
+   IKREC *target = scratch;
+
+   for (int pass=0; pass < RADIX_PASSES; ++pass)
+   {
+      size_t *histogram = histograms[pass];
+      int shift = pass * RADIX_BITS;
+
+      // Skip pass if all keys share the same byte value
+      uint64_t first_digit = (radix_sortable(source->key, descending) >> shift)
+         & (RADIX_BUCKETS-1);
+      if (histogram[first_digit] == (size_t)count)
+         continue;
+
+      // Convert counts to starting offsets
+      size_t offset = 0;
+      for (int bucket=0; bucket < RADIX_BUCKETS; ++bucket)
+      {
+         size_t bucket_count = histogram[bucket];
+         histogram[bucket] = offset;
+         offset += bucket_count;
+      }
+
+      rec = source;
+      rec_end = source + count;
+      while (rec < rec_end)
+      {
+         uint64_t digit = (radix_sortable(rec->key, descending) >> shift)
+            & (RADIX_BUCKETS-1);
+         target[histogram[digit]++] = *rec;
+         ++rec;
+      }
+
+      IKREC *swap = source;
+      source = target;
+      target = swap;
+   }
+
+   if (source != records)
+      memcpy(records, source, count * sizeof(IKREC));
+
+   xfree(scratch);
+   xfree(histograms);
+
+   return True;
+}
@@ -0,0 +1,620 @@
+/**
+ * @file ate_sort.c
+ * @brief Parsing sort specifications and comparing rows natively
+ */
+
+#include "ate_sort.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+
+#include <ctype.h>
+#include <string.h>
+
+/**
+ * @brief Parse a sort specification string into a new SSPEC.
+ *
+ * The specification is a comma-separated list of column indexes,
+ * each optionally followed by one or more modifier letters:
+ *
+ * - `n` compare the column as integers
+ * - `s` compare the column as strings (the default)
+ * - `r` reverse the order of the column
+ * - `l` compare strings by the LC_COLLATE locale instead of by bytes
+ *
+ * For example, `2n,0r,3` sorts by column 2 numerically, then by
+ * column 0 in descending string order, then by column 3.
+ *
+ * @param "spec"     [out] where the new SSPEC will be returned.
+ *                         The caller must release it with `xfree`.
+ * @param "str"      [in]  the sort specification string
+ * @param "row_size" [in]  number of fields in a row, for validating columns
+ * @param "action"   [in]  action name for error messages
+ * @return EXECUTION_SUCCESS if parsed, EX_USAGE if the specification
+ *         is invalid.
+ */
+int sort_spec_parse(SSPEC **spec, const char *str, int row_size, const char *action)
+{
+   int retval = EX_USAGE;
+
+   if (str == NULL || *str == '\0')
+   {
+      ate_register_missing_argument("sort_spec", action);
+      goto early_exit;
+   }
+
+   // One column per comma-separated item:
+   int count = 1;
+   const char *ptr = str;
+   while (*ptr)
+      if (*ptr++ == ',')
+         ++count;
+
+   SSPEC *new_spec = (SSPEC*)xmalloc(sizeof(SSPEC) + count * sizeof(SCOL));
+   new_spec->count = count;
+
+   SCOL *col = new_spec->columns;
+   ptr = str;
+   while (*ptr)
+   {
+      if (!isdigit((unsigned char)*ptr))
+      {
+         ate_register_error("sort spec '%s' has a column without an index in '%s'", str, action);
+         goto abandon_spec;
+      }
+
+      char *end;
+      col->column = (int)strtol(ptr, &end, 10);
+      col->source = col->column;
+      col->numeric = False;
+      col->reverse = False;
+      col->collate = False;
+
+      if (col->column >= row_size)
+      {
+         ate_register_error("sort column %d is out of range for row size %d in '%s'",
+                            col->column, row_size, action);
+         goto abandon_spec;
+      }
+
+      for (ptr = end; *ptr && *ptr != ','; ++ptr)
+      {
+         switch(*ptr)
+         {
+            case 'n': col->numeric = True; break;
+            case 's': col->numeric = False; break;
+            case 'r': col->reverse = True; break;
+            case 'l': col->collate = True; break;
+            default:
+               ate_register_error("unknown modifier '%c' in sort spec '%s' in '%s'",
+                                  *ptr, str, action);
+               goto abandon_spec;
+         }
+      }
+
+      if (*ptr == ',')
+         ++ptr;
+
+      ++col;
+   }
+
+   if (col - new_spec->columns != count)
+   {
+      ate_register_error("sort spec '%s' has an empty column in '%s'", str, action);
+      goto abandon_spec;
+   }
+
+   *spec = new_spec;
+   retval = EXECUTION_SUCCESS;
+   goto early_exit;
+
+  abandon_spec:
+   xfree(new_spec);
+
+  early_exit:
+   return retval;
+}
+
+/**
+ * @brief Allocate records, their values and @p pool_size extra bytes
+ *        in a single memory block.
+ * @return pointer to new records, or NULL if out of memory
+ */
+static SREC *sort_records_allocate_block(AHEAD *head, int value_count, size_t pool_size)
+{
+   int row_count = head->row_count;
+   size_t mem_required = (size_t)row_count * sizeof(SREC)
+      + (size_t)row_count * value_count * sizeof(SVALUE)
+      + pool_size;
+
+   SREC *new_records = (SREC*)xmalloc(mem_required ? mem_required : 1);
+   if (new_records == NULL)
+      return NULL;
+
+   SVALUE *values = (SVALUE*)&new_records[row_count];
+
+   ARRAY_ELEMENT **row_ptr = head->rows;
+   SREC *rec = new_records;
+   SREC *rec_end = rec + row_count;
+
+   while (rec < rec_end)
+   {
+      rec->row = *row_ptr++;
+      rec->values = values;
+      values += value_count;
+      ++rec;
+   }
+
+   return new_records;
+}
+
+/**
+ * @brief Allocate an SREC array for a table's rows, leaving the values unset.
+ *
+ * The SREC array and the SVALUE arrays to which the records point
+ * are allocated in a single memory block, so the caller can release
+ * everything with a single `xfree` of @p records.
+ *
+ * @param "records"     [out] where the new array of records will be returned
+ * @param "head"        [in]  table whose rows the records will represent
+ * @param "value_count" [in]  number of SVALUEs to reserve for each record
+ * @return True if successful
+ */
+bool sort_records_allocate(SREC **records, AHEAD *head, int value_count)
+{
+   SREC *new_records = sort_records_allocate_block(head, value_count, 0);
+   if (new_records == NULL)
+      return False;
+
+   *records = new_records;
+   return True;
+}
+
+/**
+ * @brief Return the field value at @p column of a row
+ */
+static const char *sort_records_field(ARRAY_ELEMENT *row, int column)
+{
+   for (int i=0; i < column; ++i)
+      row = row->next;
+   return row->value;
+}
+
+/**
+ * @brief Gather the sort values of every row of a table.
+ *
+ * Integer columns are converted here, once per row, so comparisons
+ * never have to parse a string.  Values that are not integers are
+ * treated as 0.
+ *
+ * Likewise, collated columns are transformed here with `strxfrm`,
+ * once per row, so comparisons can use `strcmp` instead of the much
+ * slower `strcoll`.  The transformations are saved after the values
+ * in the records' memory block.
+ *
+ * @param "records" [out] where the new array of records will be returned,
+ *                        to be released with `xfree`
+ * @param "head"    [in]  table whose rows are to be gathered
+ * @param "spec"    [in]  columns to be gathered
+ * @return True if successful
+ */
+bool sort_records_create(SREC **records, AHEAD *head, const SSPEC *spec)
+{
+   const SCOL *col, *col_end = spec->columns + spec->count;
+
+   // Measure the transformations of collated columns
+   size_t pool_size = 0;
+   for (col = spec->columns; col < col_end; ++col)
+   {
+      if (col->collate && !col->numeric)
+      {
+         for (int i=0; i < head->row_count; ++i)
+            pool_size += strxfrm(NULL, sort_records_field(head->rows[i], col->column), 0) + 1;
+      }
+   }
+
+   SREC *new_records = sort_records_allocate_block(head, spec->count, pool_size);
+   if (new_records == NULL)
+      return False;
+
+   // The pool follows the values
+   SVALUE *values_end = (SVALUE*)&new_records[head->row_count]
+      + (size_t)head->row_count * spec->count;
+   char *pool = (char*)values_end;
+
+   SREC *rec = new_records;
+   SREC *rec_end = rec + head->row_count;
+
+   while (rec < rec_end)
+   {
+      SVALUE *values = rec->values;
+
+      for (col = spec->columns; col < col_end; ++col)
+      {
+         const char *field = sort_records_field(rec->row, col->column);
+
+         if (col->numeric)
+         {
+            values->num = 0;
+            get_long_from_string(&values->num, field);
+         }
+         else if (col->collate)
+         {
+            size_t len = strxfrm(pool, field, pool_size) + 1;
+            values->str = pool;
+            pool += len;
+            pool_size -= len;
+         }
+         else
+            values->str = field;
+
+         ++values;
+      }
+
+      ++rec;
+   }
+
+   *records = new_records;
+   return True;
+}
+
+/**
+ * @brief Compare two records according to a sort specification
+ * @param "left"   left-side record
+ * @param "right"  right-side record
+ * @param "spec"   specification that created the records' values
+ * @return <0 if left goes before right, >0 if right goes before left,
+ *         0 if equivalent
+ */
+int sort_records_compare(const SREC *left, const SREC *right, const SSPEC *spec)
+{
+   const SVALUE *lval = left->values;
+   const SVALUE *rval = right->values;
+
+   const SCOL *col = spec->columns;
+   const SCOL *col_end = col + spec->count;
+
+   int comp;
+   while (col < col_end)
+   {
+      if (col->numeric)
+         comp = (lval->num > rval->num) - (lval->num < rval->num);
+      else
+         comp = strcmp(lval->str, rval->str);
+
+      if (comp)
+         return col->reverse ? -comp : comp;
+
+      ++lval;
+      ++rval;
+      ++col;
+   }
+
+   return 0;
+}
+
+/**
+ * @brief Transfer function between @ref ate_stable_sort and @ref sort_records_compare
+ * @param "left"  [in] left-side SREC*
+ * @param "right" [in] right-side SREC*
+ * @param "spec"  [in] void* to the SSPEC that prepared the records
+ * @return -1 if left < right, 0 if left == right, 1 if left > right
+ */
+int sort_records_sort_callback(const void *left, const void *right, void *spec)
+{
+   return sort_records_compare((const SREC*)left, (const SREC*)right, (const SSPEC*)spec);
+}
+
+/**
+ * @brief Make a new string whose `strcmp` order is the LC_COLLATE
+ *        order of @p str
+ * @param "str"  string to transform
+ * @return new string, to be released with `xfree`
+ */
+char *sort_collation_key(const char *str)
+{
+   size_t len = strxfrm(NULL, str, 0) + 1;
+   char *key = (char*)xmalloc(len);
+   strxfrm(key, str, len);
+   return key;
+}
+
+/**
+ * @brief Pack the first eight bytes of a string into an integer
+ *
+ * The bytes are packed big-endian and padded with zero bytes, so
+ * unequal prefixes of two strings compare as `strcmp` compares the
+ * strings.  Equal prefixes with a zero low byte belong to equal
+ * strings; otherwise the strings must be compared from their ninth
+ * bytes.
+ */
+uint64_t sort_key_prefix(const char *str)
+{
+   uint64_t prefix = 0;
+   for (int i=0; i < 8; ++i)
+   {
+      prefix <<= 8;
+      if (*str)
+         prefix |= (unsigned char)*str++;
+   }
+
+   return prefix;
+}
+
+/**
+ * @brief Round @p offset up to a multiple of @p alignment
+ */
+static inline size_t sort_order_align(size_t offset, size_t alignment)
+{
+   return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief True if an order of a key table by a single string value, which
+ *        saves the prefix of each key to speed up searches
+ */
+static inline bool sort_order_has_prefixes(int key_column, const SSPEC *spec)
+{
+   return key_column != SORDER_TABLE_ROWS && spec->count == 1 && !spec->columns[0].numeric;
+}
+
+/**
+ * @brief Offset from the start of an SORDER to its prefix vector,
+ *        rounded up for alignment
+ */
+static size_t sort_order_prefixes_offset(const SSPEC *spec)
+{
+   return sort_order_align(sizeof(SORDER) + sizeof(SSPEC) + spec->count * sizeof(SCOL),
+                           sizeof(uint64_t));
+}
+
+/**
+ * @brief True if a key table order, with prefixes, is also to be laid
+ *        out for Eytzinger searches, which need ascending keys
+ */
+static inline bool sort_order_has_eytzinger(int key_column,
+                                            const SSPEC *spec,
+                                            const SOEXTRAS *extras)
+{
+   return extras && extras->eytzinger
+      && sort_order_has_prefixes(key_column, spec)
+      && !spec->columns[0].reverse;
+}
+
+/**
+ * @brief Bits per key of the Bloom filter to be recorded with a key
+ *        table order with prefixes, or 0 if none
+ */
+static inline int sort_order_bloom_bits(int key_column, const SSPEC *spec, const SOEXTRAS *extras)
+{
+   if (extras && sort_order_has_prefixes(key_column, spec))
+      return extras->bloom_bits;
+
+   return 0;
+}
+
+/**
+ * @brief Offset from the start of an SORDER to its collation vector,
+ *        rounded up for pointer alignment
+ * @param "spec"         specification of the order
+ * @param "prefix_count" number of saved key prefixes
+ * @param "slot_count"   number of Eytzinger slots, including unused slot 0
+ */
+static size_t sort_order_collation_offset(const SSPEC *spec, int prefix_count, int slot_count)
+{
+   size_t offset = sort_order_prefixes_offset(spec)
+      + prefix_count * sizeof(uint64_t)
+      + slot_count * (sizeof(uint64_t) + sizeof(int32_t));
+
+   return sort_order_align(offset, sizeof(char*));
+}
+
+/**
+ * @brief Assign sorted row indexes to Eytzinger slots by an in-order
+ *        walk of the implicit tree whose node @p slot has children
+ *        `2*slot` and `2*slot+1`
+ * @param "rows"       [out] row index of each slot
+ * @param "slot_count" number of slots, including unused slot 0
+ * @param "row"        next row index to assign
+ * @param "slot"       root of the subtree to fill
+ * @return the next row index to assign after the subtree
+ */
+static int sort_order_eytzinger_fill(int32_t *rows, int slot_count, int row, int slot)
+{
+   if (slot < slot_count)
+   {
+      row = sort_order_eytzinger_fill(rows, slot_count, row, 2 * slot);
+      rows[slot] = row++;
+      row = sort_order_eytzinger_fill(rows, slot_count, row, 2 * slot + 1);
+   }
+
+   return row;
+}
+
+/**
+ * @brief Number of bytes needed to record an order after the last
+ *        row pointer of a head
+ * @param "key_column" column of a key table, or a SORDER_ constant
+ * @param "spec"       specification of the order to be recorded
+ * @param "collated"   records of a collated key in row order, or NULL
+ * @param "extras"     search aids for a string key, or NULL
+ * @param "row_count"  number of rows in the order
+ */
+size_t sort_order_size(int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras,
+                       int row_count)
+{
+   int prefix_count = sort_order_has_prefixes(key_column, spec) ? row_count : 0;
+   int slot_count = sort_order_has_eytzinger(key_column, spec, extras) ? row_count + 1 : 0;
+   size_t size = sort_order_collation_offset(spec, prefix_count, slot_count);
+
+   if (collated)
+   {
+      size += row_count * sizeof(char*);
+      for (int i=0; i < row_count; ++i)
+         size += strlen(collated[i]->values->str) + 1;
+   }
+
+   int bloom_bits = sort_order_bloom_bits(key_column, spec, extras);
+   if (bloom_bits)
+      size = sort_order_align(size, sizeof(uint64_t)) + bloom_filter_size(row_count, bloom_bits);
+
+   return size;
+}
+
+/**
+ * @brief Record, in the unused end of a head's memory block, how its
+ *        rows were ordered.
+ *
+ * The head must have been allocated with at least
+ * `ate_head_annex_offset(head) + sort_order_size(...)`
+ * bytes.  The record is released when the head is freed.
+ *
+ * A key table ordered by string value, which must already be in
+ * order, gets a contiguous vector of key prefixes that `seek_key`
+ * compares before touching any key value.
+ *
+ * The transformed keys of a collated key table are copied into the
+ * record so that `seek_key` can search the key without transforming
+ * any key values.  Its prefixes are those of the transformed keys.
+ *
+ * If requested for an ascending string key table, the prefixes are
+ * copied again in Eytzinger order: the order in which a binary search
+ * of the rows visits them, level by level, with the children of slot
+ * k in slots 2k and 2k+1.  The nodes a search visits first share the
+ * first cache lines, and the next nodes can be prefetched, so the
+ * search can step down the tree without unpredictable branches.
+ *
+ * If requested for a string key table, a Bloom filter of the compared
+ * key values (the transformations of a collated key) ends the record,
+ * so `seek_key` can report most absent values without a search.
+ *
+ * @param "head"         [in,out] head whose order is to be recorded
+ * @param "source_array" [in]     array of the table whose rows were ordered
+ * @param "source_rows"  [in]     number of source handle rows included
+ * @param "key_column"   [in]     source column of a key table, or one of
+ *                                SORDER_TABLE_ROWS or SORDER_FUNCTION_KEY
+ * @param "spec"         [in]     specification by which rows were ordered
+ * @param "collated"     [in]     NULL, or for a collated key table, the
+ *                                sort records in the order of the rows
+ * @param "extras"       [in]     NULL, or search aids to add to the
+ *                                order of a string key table
+ */
+void sort_order_attach(AHEAD *head,
+                       SHELL_VAR *source_array,
+                       int source_rows,
+                       int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras)
+{
+   SORDER *order = (SORDER*)((char*)head + ate_head_annex_offset(head));
+   order->source_array = source_array;
+   order->source_rows = source_rows;
+   order->key_column = key_column;
+   order->spec = (SSPEC*)&order[1];
+   memcpy(order->spec, spec, sizeof(SSPEC) + spec->count * sizeof(SCOL));
+   order->prefixes = NULL;
+   order->eytzinger_prefixes = NULL;
+   order->eytzinger_rows = NULL;
+   order->collation = NULL;
+   order->bloom = NULL;
+
+   int prefix_count = 0;
+   int slot_count = 0;
+   if (sort_order_has_prefixes(key_column, spec))
+   {
+      uint64_t *prefixes = (uint64_t*)((char*)order + sort_order_prefixes_offset(spec));
+      for (int i=0; i < head->row_count; ++i)
+      {
+         const char *key = collated ? collated[i]->values->str : head->rows[i]->value;
+         prefixes[i] = sort_key_prefix(key);
+      }
+
+      order->prefixes = prefixes;
+      prefix_count = head->row_count;
+
+      if (sort_order_has_eytzinger(key_column, spec, extras))
+      {
+         slot_count = head->row_count + 1;
+         uint64_t *slot_prefixes = &prefixes[prefix_count];
+         int32_t *slot_rows = (int32_t*)&slot_prefixes[slot_count];
+
+         // Slot 0 stands for the end of the rows, where a search ends
+         // if every key is less than the search value
+         slot_prefixes[0] = 0;
+         slot_rows[0] = head->row_count;
+         sort_order_eytzinger_fill(slot_rows, slot_count, 0, 1);
+         for (int slot=1; slot < slot_count; ++slot)
+            slot_prefixes[slot] = prefixes[slot_rows[slot]];
+
+         order->eytzinger_prefixes = slot_prefixes;
+         order->eytzinger_rows = slot_rows;
+      }
+   }
+
+   char *pool = (char*)order + sort_order_collation_offset(spec, prefix_count, slot_count);
+   if (collated)
+   {
+      const char **collation = (const char**)pool;
+      pool = (char*)&collation[head->row_count];
+      for (int i=0; i < head->row_count; ++i)
+      {
+         const char *key = collated[i]->values->str;
+         size_t len = strlen(key) + 1;
+         memcpy(pool, key, len);
+         collation[i] = pool;
+         pool += len;
+      }
+
+      order->collation = collation;
+   }
+
+   int bloom_bits = sort_order_bloom_bits(key_column, spec, extras);
+   if (bloom_bits)
+   {
+      BLOOM *bloom = (BLOOM*)((char*)order
+                              + sort_order_align(pool - (char*)order, sizeof(uint64_t)));
+      bloom_filter_init(bloom, head->row_count, bloom_bits);
+      for (int i=0; i < head->row_count; ++i)
+         bloom_filter_add(bloom, collated ? collated[i]->values->str : head->rows[i]->value);
+
+      order->bloom = bloom;
+   }
+
+   head->order = order;
+}
+
+/**
+ * @brief Enlarge a head's memory block and record its order.
+ * @param "head"  [in,out] head to be reallocated, which may move
+ * @return True if successful, False if the memory could not be
+ *         reallocated (the original head remains valid)
+ *
+ * See @ref sort_order_attach for the remaining arguments.
+ */
+bool sort_order_append(AHEAD **head,
+                       SHELL_VAR *source_array,
+                       int source_rows,
+                       int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras)
+{
+   int row_count = (*head)->row_count;
+   size_t mem_required = ate_head_annex_offset(*head)
+      + sort_order_size(key_column, spec, collated, extras, row_count);
+
+   AHEAD *new_head = (AHEAD*)xrealloc(*head, mem_required);
+   if (new_head == NULL)
+      return False;
+
+   // The row indexes of a native key moved with the head
+   if (new_head->key_rows)
+      new_head->key_rows = (int32_t*)&new_head->rows[row_count];
+
+   sort_order_attach(new_head, source_array, source_rows, key_column, spec, collated, extras);
+   *head = new_head;
+   return True;
+}
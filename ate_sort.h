@@ -0,0 +1,151 @@
+#ifndef ATE_SORT_H
+#define ATE_SORT_H
+
+#include <builtins.h>
+// Prevent multiple inclusion of shell.h:
+#ifndef EXECUTION_FAILURE
+#include <shell.h>
+#endif
+
+#include "ate_handle.h"
+#include "ate_bloom.h"
+
+#include <stdint.h>
+
+/**
+ * @defgroup ATE_SORT Native Sorting Support
+ *
+ * Resources for ordering table rows without calling a shell
+ * function for each comparison.  A sort specification like
+ * `2n,0r,3` is parsed into a @ref SSPEC, the field values of each
+ * row are gathered once into a @ref SREC, and the records are then
+ * compared entirely in C.
+ * @{
+ */
+
+/**
+ * @brief Single column of a sort specification
+ */
+typedef struct sort_column {
+   int column;      ///< index of the field in a row
+   int source;      ///< source table column of a key table column,
+                    ///< otherwise the same as @p column
+   bool numeric;    ///< compare as long integers instead of strings
+   bool reverse;    ///< sort in descending order
+   bool collate;    ///< compare strings by the LC_COLLATE locale
+} SCOL;
+
+/**
+ * @brief Parsed sort specification, columns in order of precedence
+ */
+typedef struct sort_spec {
+   int count;         ///< number of elements in @p columns
+   SCOL columns[];    ///< beginning of array of columns
+} SSPEC;
+
+/**
+ * @brief Field value prepared for comparison, interpreted according
+ *        to the SCOL::numeric member of the matching column
+ */
+typedef union sort_value {
+   const char *str;   ///< string value of a field, or its strxfrm
+                      ///< transformation for a collated column
+   long        num;   ///< integer value of a field
+} SVALUE;
+
+/**
+ * @brief A table row with its prepared sort values
+ */
+typedef struct sort_record {
+   ARRAY_ELEMENT *row;     ///< first element of the row
+   SVALUE        *values;  ///< one value for each SSPEC column
+} SREC;
+
+/**
+ * @brief Record of how a handle's rows were ordered, kept in the
+ *        handle's memory block after the last row pointer so that
+ *        rows added to the table later can be merged into the order.
+ */
+typedef struct sort_order {
+   SHELL_VAR *source_array;  ///< array of the table whose rows were ordered
+   int       source_rows;    ///< number of source handle rows in the order
+   int       key_column;     ///< column copied to a key table, or one of
+                             ///< SORDER_TABLE_ROWS or SORDER_FUNCTION_KEY
+   SSPEC     *spec;          ///< specification of the order, follows this struct
+   const uint64_t *prefixes; ///< packed key prefix (see sort_key_prefix) of
+                             ///< each row of a string key table, or NULL
+   const uint64_t *eytzinger_prefixes; ///< @p prefixes in Eytzinger order,
+                                       ///< slots 1 to row_count, or NULL
+   const int32_t  *eytzinger_rows;     ///< row index of each Eytzinger slot,
+                                       ///< with the row count in slot 0
+   const char **collation;   ///< strxfrm transformations of a collated key
+                             ///< for each row, or NULL, follows @p prefixes
+   const BLOOM *bloom;       ///< Bloom filter of the values of a string key
+                             ///< table, or NULL, follows @p collation
+} SORDER;
+
+/**
+ * @brief Optional search aids to record with the order of a string
+ *        key table (see @ref sort_order_attach)
+ */
+typedef struct sort_order_extras {
+   bool eytzinger;           ///< add the Eytzinger layout (make_key -E)
+   int  bloom_bits;          ///< bits per key of a Bloom filter (make_key -B),
+                             ///< or 0 for no filter
+} SOEXTRAS;
+
+#define SORDER_TABLE_ROWS   -1   ///< SORDER::key_column of a sorted table
+#define SORDER_FUNCTION_KEY -2   ///< SORDER::key_column of keys from a function
+
+int sort_spec_parse(SSPEC **spec, const char *str, int row_size, const char *action);
+
+bool sort_records_allocate(SREC **records, AHEAD *head, int value_count);
+bool sort_records_create(SREC **records, AHEAD *head, const SSPEC *spec);
+int sort_records_compare(const SREC *left, const SREC *right, const SSPEC *spec);
+int sort_records_sort_callback(const void *left, const void *right, void *spec);
+
+char *sort_collation_key(const char *str);
+uint64_t sort_key_prefix(const char *str);
+
+size_t sort_order_size(int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras,
+                       int row_count);
+void sort_order_attach(AHEAD *head,
+                       SHELL_VAR *source_array,
+                       int source_rows,
+                       int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras);
+bool sort_order_append(AHEAD **head,
+                       SHELL_VAR *source_array,
+                       int source_rows,
+                       int key_column,
+                       const SSPEC *spec,
+                       SREC **collated,
+                       const SOEXTRAS *extras);
+
+/**
+ * @brief Comparison function for @ref ate_stable_sort, which receives
+ *        the vector elements themselves (not pointers to them).
+ */
+typedef int (*ATE_SORT_COMP)(const void *left, const void *right, void *data);
+
+bool ate_stable_sort(void **vector, int count, ATE_SORT_COMP comp, void *data);
+bool ate_merge_runs(void **vector, int left_count, int count, ATE_SORT_COMP comp, void *data);
+
+/**
+ * @brief A row with a key value already converted to an integer
+ */
+typedef struct int_key_record {
+   int64_t       key;   ///< integer value of the row's key
+   ARRAY_ELEMENT *row;  ///< row to which the key belongs
+} IKREC;
+
+bool ate_radix_sort(IKREC *records, int count, bool descending);
+
+/** @} */
+
+#endif
@@ -0,0 +1,430 @@
+/**
+ * @file ate_timsort.c
+ * @brief Stable, run-detecting merge sort for vectors of pointers
+ *
+ * This is a simplified timsort.  It finds the naturally ordered runs
+ * in the vector, extends short runs with a binary insertion sort,
+ * and merges the runs pairwise under the timsort stack invariants.
+ * Before each merge, the parts of the two runs that are already in
+ * place are skipped with exponential searches, so appending a few
+ * rows to an already-sorted table costs little more than a single
+ * pass to confirm the order.
+ *
+ * Equal elements always keep their original relative order.
+ */
+
+#include "ate_sort.h"
+
+/**
+ * @brief Maximum number of pending runs.  Run lengths on the stack
+ *        grow at least as fast as the Fibonacci sequence, so this
+ *        is enough for any `int` element count.
+ */
+#define TIMSORT_MAX_RUNS 64
+
+/**
+ * @brief Shortest vector length for which runs are merged.
+ *        Shorter vectors are simply binary-insertion sorted.
+ */
+#define TIMSORT_MIN_MERGE 32
+
+typedef struct timsort_state {
+   void          **base;      ///< vector being sorted
+   ATE_SORT_COMP comp;        ///< comparison function
+   void          *data;       ///< user data for comparison function
+   void          **temp;      ///< scratch space for merges
+   int           run_count;   ///< number of runs on the stack
+   int           run_base[TIMSORT_MAX_RUNS];
+   int           run_len[TIMSORT_MAX_RUNS];
+} TSSTATE;
+
+/**
+ * @brief Calculate the minimum run length for a vector of @p n elements,
+ *        a value between TIMSORT_MIN_MERGE/2 and TIMSORT_MIN_MERGE such
+ *        that n/minrun is a power of two or slightly less.
+ */
+static int timsort_min_run(int n)
+{
+   int low_bits = 0;
+   while (n >= TIMSORT_MIN_MERGE)
+   {
+      low_bits |= n & 1;
+      n >>= 1;
+   }
+   return n + low_bits;
+}
+
+/**
+ * @brief Reverse elements from @p lo up to, but not including, @p hi
+ */
+static void timsort_reverse(void **lo, void **hi)
+{
+   --hi;
+   while (lo < hi)
+   {
+      void *temp = *lo;
+      *lo++ = *hi;
+      *hi-- = temp;
+   }
+}
+
+/**
+ * @brief Return the length of the run beginning at @p lo, reversing it
+ *        in place if it is descending.
+ *
+ * Only strictly descending runs are reversed, so the reversal never
+ * changes the order of equal elements.
+ */
+static int timsort_count_run(TSSTATE *ts, void **lo, void **hi)
+{
+   void **run_end = lo + 1;
+   if (run_end == hi)
+      return 1;
+
+   if ((*ts->comp)(*run_end, *lo, ts->data) < 0)
+   {
+      ++run_end;
+      while (run_end < hi && (*ts->comp)(*run_end, *(run_end-1), ts->data) < 0)
+         ++run_end;
+      timsort_reverse(lo, run_end);
+   }
+   else
+   {
+      ++run_end;
+      while (run_end < hi && (*ts->comp)(*run_end, *(run_end-1), ts->data) >= 0)
+         ++run_end;
+   }
+
+   return run_end - lo;
+}
+
+/**
+ * @brief Sort elements from @p lo to @p hi with a binary insertion sort,
+ *        given that elements from @p lo to @p start are already sorted.
+ */
+static void timsort_binary_insertion(TSSTATE *ts, void **lo, void **hi, void **start)
+{
+   for (; start < hi; ++start)
+   {
+      void *pivot = *start;
+
+      // Find the position after any elements equal to pivot
+      void **left = lo;
+      void **right = start;
+      while (left < right)
+      {
+         void **mid = left + (right - left) / 2;
+         if ((*ts->comp)(pivot, *mid, ts->data) < 0)
+            right = mid;
+         else
+            left = mid + 1;
+      }
+
+      memmove(left + 1, left, (start - left) * sizeof(void*));
+      *left = pivot;
+   }
+}
+
+/**
+ * @brief Count elements at the beginning of @p vec that are less than
+ *        or equal to @p key, probing exponentially from the start.
+ */
+static int timsort_gallop_right(TSSTATE *ts, void *key, void **vec, int len)
+{
+   int last = 0, offset = 1;
+
+   if ((*ts->comp)(key, vec[0], ts->data) < 0)
+      return 0;
+
+   // vec[last] <= key; find offset where key < vec[offset]
+   while (offset < len && (*ts->comp)(key, vec[offset], ts->data) >= 0)
+   {
+      last = offset;
+      offset = (offset << 1) + 1;
+      if (offset <= 0)
+         offset = len;
+   }
+   if (offset > len)
+      offset = len;
+
+   // Binary search between vec[last] <= key and key < vec[offset]
+   ++last;
+   while (last < offset)
+   {
+      int mid = last + (offset - last) / 2;
+      if ((*ts->comp)(key, vec[mid], ts->data) < 0)
+         offset = mid;
+      else
+         last = mid + 1;
+   }
+
+   return offset;
+}
+
+/**
+ * @brief Count elements at the beginning of @p vec that are strictly
+ *        less than @p key, probing exponentially from the end.
+ */
+static int timsort_gallop_left(TSSTATE *ts, void *key, void **vec, int len)
+{
+   int last = 0, offset = 1;
+
+   if ((*ts->comp)(vec[len-1], key, ts->data) < 0)
+      return len;
+
+   // key <= vec[len-1-last]; find offset where vec[len-1-offset] < key
+   while (offset < len && (*ts->comp)(vec[len-1-offset], key, ts->data) >= 0)
+   {
+      last = offset;
+      offset = (offset << 1) + 1;
+      if (offset <= 0)
+         offset = len;
+   }
+   if (offset > len)
+      offset = len;
+
+   // Convert to a range counted from the start:
+   // vec[lo-1] < key <= vec[hi]
+   int lo = len - offset;
+   int hi = len - 1 - last;
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      if ((*ts->comp)(vec[mid], key, ts->data) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return hi;
+}
+
+/**
+ * @brief Merge adjacent runs where the left run is not longer than the right
+ */
+static void timsort_merge_lo(TSSTATE *ts, void **left, int left_len, void **right, int right_len)
+{
+   memcpy(ts->temp, left, left_len * sizeof(void*));
+
+   void **dest = left;
+   void **lptr = ts->temp;
+   void **lend = lptr + left_len;
+   void **rptr = right;
+   void **rend = rptr + right_len;
+
+   while (lptr < lend && rptr < rend)
+   {
+      // Take from the right only when strictly less, for stability
+      if ((*ts->comp)(*rptr, *lptr, ts->data) < 0)
+         *dest++ = *rptr++;
+      else
+         *dest++ = *lptr++;
+   }
+
+   // Remaining right elements are already in place
+   memcpy(dest, lptr, (lend - lptr) * sizeof(void*));
+}
+
+/**
+ * @brief Merge adjacent runs where the right run is shorter than the left
+ */
+static void timsort_merge_hi(TSSTATE *ts, void **left, int left_len, void **right, int right_len)
+{
+   memcpy(ts->temp, right, right_len * sizeof(void*));
+
+   void **dest = right + right_len - 1;
+   void **lptr = left + left_len - 1;
+   void **rptr = ts->temp + right_len - 1;
+
+   while (lptr >= left && rptr >= ts->temp)
+   {
+      // Take from the left only when strictly greater, for stability
+      if ((*ts->comp)(*rptr, *lptr, ts->data) < 0)
+         *dest-- = *lptr--;
+      else
+         *dest-- = *rptr--;
+   }
+
+   // Remaining left elements are already in place
+   int remaining = rptr - ts->temp + 1;
+   memcpy(left, ts->temp, remaining * sizeof(void*));
+}
+
+/**
+ * @brief Merge the runs at stack positions @p i and @p i+1
+ */
+static void timsort_merge_at(TSSTATE *ts, int i)
+{
+   void **left = ts->base + ts->run_base[i];
+   int left_len = ts->run_len[i];
+   void **right = ts->base + ts->run_base[i+1];
+   int right_len = ts->run_len[i+1];
+
+   ts->run_len[i] = left_len + right_len;
+   if (i == ts->run_count - 3)
+   {
+      ts->run_base[i+1] = ts->run_base[i+2];
+      ts->run_len[i+1] = ts->run_len[i+2];
+   }
+   --ts->run_count;
+
+   // Skip left elements already in place before the first right element
+   int skip = timsort_gallop_right(ts, *right, left, left_len);
+   left += skip;
+   left_len -= skip;
+   if (left_len == 0)
+      return;
+
+   // Skip right elements already in place after the last left element
+   right_len = timsort_gallop_left(ts, left[left_len-1], right, right_len);
+   if (right_len == 0)
+      return;
+
+   if (left_len <= right_len)
+      timsort_merge_lo(ts, left, left_len, right, right_len);
+   else
+      timsort_merge_hi(ts, left, left_len, right, right_len);
+}
+
+/**
+ * @brief Merge runs on the stack until the timsort invariants hold:
+ *        each run is longer than the sum of the two runs above it.
+ */
+static void timsort_merge_collapse(TSSTATE *ts)
+{
+   int *len = ts->run_len;
+   while (ts->run_count > 1)
+   {
+      int n = ts->run_count - 2;
+      if ((n > 0 && len[n-1] <= len[n] + len[n+1])
+          || (n > 1 && len[n-2] <= len[n-1] + len[n]))
+      {
+         if (len[n-1] < len[n+1])
+            --n;
+      }
+      else if (len[n] > len[n+1])
+         break;
+
+      timsort_merge_at(ts, n);
+   }
+}
+
+/**
+ * @brief Merge all remaining runs on the stack
+ */
+static void timsort_merge_force_collapse(TSSTATE *ts)
+{
+   int *len = ts->run_len;
+   while (ts->run_count > 1)
+   {
+      int n = ts->run_count - 2;
+      if (n > 0 && len[n-1] < len[n+1])
+         --n;
+      timsort_merge_at(ts, n);
+   }
+}
+
+/**
+ * @brief Stable sort of a vector of pointers, like an ARRAY_ELEMENT*
+ *        vector of row heads.
+ *
+ * Unlike `qsort_r`, the comparison function receives the vector
+ * elements themselves rather than pointers to the elements.
+ *
+ * @param "vector"  [in,out] vector of pointers to sort
+ * @param "count"   [in]     number of elements in @p vector
+ * @param "comp"    [in]     comparison function
+ * @param "data"    [in]     user data passed through to @p comp
+ * @return True if sorted, False if scratch memory was unavailable
+ */
+bool ate_stable_sort(void **vector, int count, ATE_SORT_COMP comp, void *data)
+{
+   if (count < 2)
+      return True;
+
+   TSSTATE ts = { vector, comp, data, NULL, 0 };
+
+   void **lo = vector;
+   void **hi = vector + count;
+
+   if (count < TIMSORT_MIN_MERGE)
+   {
+      int run_len = timsort_count_run(&ts, lo, hi);
+      timsort_binary_insertion(&ts, lo, hi, lo + run_len);
+      return True;
+   }
+
+   // A merge never needs more than half of the vector
+   ts.temp = (void**)xmalloc((count / 2 + 1) * sizeof(void*));
+   if (ts.temp == NULL)
+      return False;
+
+   int min_run = timsort_min_run(count);
+   int remaining = count;
+   while (remaining > 0)
+   {
+      int run_len = timsort_count_run(&ts, lo, hi);
+
+      // Extend short runs to min_run
+      if (run_len < min_run)
+      {
+         int forced = remaining < min_run ? remaining : min_run;
+         timsort_binary_insertion(&ts, lo, lo + forced, lo + run_len);
+         run_len = forced;
+      }
+
+      ts.run_base[ts.run_count] = lo - vector;
+      ts.run_len[ts.run_count] = run_len;
+      ++ts.run_count;
+      timsort_merge_collapse(&ts);
+
+      lo += run_len;
+      remaining -= run_len;
+   }
+
+   timsort_merge_force_collapse(&ts);
+
+   xfree(ts.temp);
+   return True;
+}
+
+/**
+ * @brief Stable merge of two adjacent sorted runs of a vector
+ *
+ * This is the merge step of @ref ate_stable_sort by itself, for
+ * merging a few newly sorted elements into a long sorted vector.
+ * Elements of either run that are already in place are skipped by
+ * exponential searches, so the cost depends mostly on how far the
+ * runs overlap.  Equal elements from the left run stay before those
+ * from the right run.
+ *
+ * @param "vector"     [in,out] vector whose two runs are to be merged
+ * @param "left_count" [in]     number of elements in the first run
+ * @param "count"      [in]     total number of elements in @p vector
+ * @param "comp"       [in]     comparison function
+ * @param "data"       [in]     user data passed through to @p comp
+ * @return True if merged, False if scratch memory was unavailable
+ */
+bool ate_merge_runs(void **vector, int left_count, int count, ATE_SORT_COMP comp, void *data)
+{
+   int right_count = count - left_count;
+   if (left_count < 1 || right_count < 1)
+      return True;
+
+   TSSTATE ts = { vector, comp, data, NULL, 2 };
+   ts.run_base[0] = 0;
+   ts.run_len[0] = left_count;
+   ts.run_base[1] = left_count;
+   ts.run_len[1] = right_count;
+
+   // A merge copies only the shorter run
+   int temp_count = left_count < right_count ? left_count : right_count;
+   ts.temp = (void**)xmalloc(temp_count * sizeof(void*));
+   if (ts.temp == NULL)
+      return False;
+
+   timsort_merge_at(&ts, 0);
+
+   xfree(ts.temp);
+   return True;
+}
@@ -9,10 +9,11 @@
 #include "word_list_stack.h"
 
 // Copied from bash source header execute_cmd.h:
-extern int execute_command PARAMS((COMMAND *));
+extern int execute_shell_function PARAMS((SHELL_VAR *, WORD_LIST *));
 
 #include <stdio.h>
-#include <stdarg.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <assert.h>
 
 /**
@@ -155,8 +156,9 @@ int int_strcmp(const char *left, const char *right)
 /**
  * @brief Converts arguments to integers and then compares as integers.
  *
- * This function returns `0` if either the @ref left or @ref right
- * argument cannot be converted to a long integer.
+ * An argument that cannot be converted to a long integer compares
+ * as `0`, the value make_key -i sorts it as, so searches of an
+ * integer key agree with its order.
  *
  * This function is used by @ref pwla_make_key and @ref pwla_seek_key
  * to enable sorting rows by integer key values.
@@ -164,29 +166,24 @@ int int_strcmp(const char *left, const char *right)
  * @param "left"   left-side comparator
  * @param "right"  right-side comparator
  * @return <0 if left < right, >0 if left > right
- *         0 ifleft==right OR if either @ref left or @ref right
- *         cannot be converted to an integer.
+ *         0 if left==right
  */
 int long_strcmp(const char *left, const char *right)
 {
    long ileft=0, iright=0;
-   if (get_long_from_string(&ileft, left))
-      if (get_long_from_string(&iright, right))
-      {
-         // The difference between ileft and iright might
-         // overflow an *int* return value, so I figure
-         // two comparisons is computationally cheaper than
-         // subtraction and division to fit a long into and int.
-         // comparing
-         if (ileft > iright)
-            return 1;
-         else if (ileft < iright)
-            return -1;
-         else
-            return 0;
-      }
-
-   return 0;
+   get_long_from_string(&ileft, left);
+   get_long_from_string(&iright, right);
+
+   // The difference between ileft and iright might
+   // overflow an *int* return value, so I figure
+   // two comparisons is computationally cheaper than
+   // subtraction and division to fit a long into and int.
+   if (ileft > iright)
+      return 1;
+   else if (ileft < iright)
+      return -1;
+   else
+      return 0;
 }
 
 
@@ -389,6 +386,19 @@ ARRAY_ELEMENT *get_end_of_row(ARRAY_ELEMENT *row, int row_size)
    return row;
 }
 
+/**
+ * @brief Returns the value of a field of a virtual row
+ * @param "row"     head element of the row
+ * @param "column"  index of the field in the row
+ * @return the field value, or an empty string for an unset field
+ */
+const char *get_row_field(ARRAY_ELEMENT *row, int column)
+{
+   for (int i=0; i < column; ++i)
+      row = row->next;
+   return row->value ? row->value : "";
+}
+
 /**
  * @brief Change a table's row size and add empty fields to the end
  *        of each row.
@@ -569,18 +579,161 @@ int table_contract_rows(AHEAD *head, int fields_to_remove)
    return retval;
 }
 
-int update_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, int row_size)
+/**
+ * @brief Release the record of a row array's buffers
+ *
+ * The buffers themselves belong to the array's elements.
+ */
+void row_buffers_release(RBUFS *rbufs)
+{
+   if (rbufs->buffers)
+      xfree(rbufs->buffers);
+
+   memset(rbufs, 0, sizeof(RBUFS));
+}
+
+/**
+ * @brief Record the buffers of an array whose elements were just
+ *        inserted, each allocated to fit its value.
+ */
+static void row_buffers_record(RBUFS *rbufs, ARRAY *array)
+{
+   if (rbufs->limit < array->num_elements)
+   {
+      rbufs->limit = array->num_elements;
+      rbufs->buffers = (RBUF*)xrealloc(rbufs->buffers, rbufs->limit * sizeof(RBUF));
+   }
+
+   RBUF *buffer = rbufs->buffers;
+   for (ARRAY_ELEMENT *ael = array->head->next; ael != array->head; ael = ael->next)
+   {
+      buffer->element = ael;
+      buffer->value = ael->value;
+      buffer->length = ael->value ? strlen(ael->value) : 0;
+      buffer->capacity = ael->value ? buffer->length + 1 : 0;
+      ++buffer;
+   }
+
+   rbufs->count = array->num_elements;
+}
+
+/**
+ * @brief Return the recorded buffer of an element, or NULL if buffers
+ *        are not being kept.
+ */
+static RBUF *row_buffer_at(RBUFS *rbufs, int index)
+{
+   return rbufs ? &rbufs->buffers[index] : NULL;
+}
+
+/**
+ * @brief Replace the value of an array element, writing it into the
+ *        element's buffer if the buffer is large enough.
+ *
+ * The capacity of a buffer is only trusted while the element still
+ * holds the buffer and the value last written to it, in case the
+ * callback assigned the element.  A buffer is only replaced by a
+ * larger one, so values of varying lengths settle into buffers that
+ * fit the longest of them.
+ *
+ * @param "element" [in,out] element whose value is replaced
+ * @param "value"   [in]     new value, may be NULL
+ * @param "buffer"  [in,out] record of the element's buffer, or NULL
+ *                           to always copy @p value to a new buffer
+ */
+static void replace_element_value(ARRAY_ELEMENT *element, const char *value, RBUF *buffer)
+{
+   size_t len = value ? strlen(value) : 0;
+
+   if (buffer && value
+       && buffer->element == element
+       && buffer->value
+       && buffer->value == element->value
+       && len < buffer->capacity
+       && buffer->length == strlen(element->value))
+   {
+      memcpy(element->value, value, len + 1);
+      buffer->length = len;
+      return;
+   }
+
+   FREE(element->value);
+   element->value = value ? savestring(value) : NULL;
+
+   if (buffer)
+   {
+      buffer->element = element;
+      buffer->value = element->value;
+      buffer->length = len;
+      buffer->capacity = value ? len + 1 : 0;
+   }
+}
+
+/**
+ * @brief Return the first element of an array if its elements are
+ *        indexed from 0 to @p count - 1, as they are when a row was
+ *        last copied in, otherwise NULL.
+ *
+ * If buffers are being kept, they must also have been recorded for
+ * @p count elements.
+ */
+static ARRAY_ELEMENT *reusable_row_elements(ARRAY *array, int count, const RBUFS *rbufs)
+{
+   if (rbufs && rbufs->count != count)
+      return NULL;
+
+   if (array->num_elements == count && array->max_index == count - 1)
+      return array->head->next;
+
+   return NULL;
+}
+
+/**
+ * @brief Fill an array with the fields of a row
+ *
+ * The elements of a row array are reused from one row to the next.
+ * With @p rbufs, the capacities of the elements' buffers are kept
+ * for the duration of an action, so delivering rows of the same size
+ * to a callback does no allocation unless a value is longer than
+ * any its element has held.  If the callback has added or removed
+ * elements, the array is rebuilt.
+ *
+ * @param "target_var"  [in,out] array to receive the row
+ * @param "source_row"  [in]     first element of the row
+ * @param "row_size"    [in]     number of fields to copy
+ * @param "rbufs"       [in,out] buffers of @p target_var, or NULL
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+int update_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, int row_size, RBUFS *rbufs)
 {
    ARRAY *array = array_cell(target_var);
-   array_flush(array);
 
    ARRAY_ELEMENT *ael = source_row;
-
    int index = 0;
-   while (ael && index < row_size)
+
+   ARRAY_ELEMENT *target = reusable_row_elements(array, row_size, rbufs);
+   if (target)
    {
-      array_insert(array, index++, ael->value);
-      ael = ael->next;
+      while (ael && index < row_size)
+      {
+         replace_element_value(target, ael->value, row_buffer_at(rbufs, index));
+         target = target->next;
+         ael = ael->next;
+         ++index;
+      }
+   }
+   else
+   {
+      array_flush(array);
+
+      while (ael && index < row_size)
+      {
+         array_insert(array, index++, ael->value);
+         ael = ael->next;
+      }
+
+      if (rbufs)
+         row_buffers_record(rbufs, array);
    }
 
    if (index < row_size)
@@ -593,61 +746,237 @@ int update_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, int row_s
 }
 
 /**
- * @brief Invoke a shell function with the parameters of this function
- *        call
- * @param "function"  [in] validated shell function variable
- * @param  ...        [in] following arguments will be passed on as
- *                         parameters to the function.
- * @return EXECUTION_SUCCESS or a non-zero error value if it fails.
+ * @brief Fill an array with a row of a handle
+ *
+ * The row of a native key handle (make_key -n) is its key value and
+ * the source row index, as in the rows of an ordinary key table.
+ *
+ * @param "target_var" [in,out] array to receive the row
+ * @param "head"       [in]     handle whose row is to be copied
+ * @param "row_index"  [in]     valid index of the row
+ * @param "rbufs"      [in,out] buffers of @p target_var, or NULL
+ * @return EXECUTION_SUCCESS or one of the failure codes
  */
-int invoke_shell_function(SHELL_VAR *function, ...)
+int update_head_row_array(SHELL_VAR *target_var, const AHEAD *head, int row_index, RBUFS *rbufs)
 {
-   WORD_LIST *list = NULL, *tail = NULL;
+   if (head->key_rows == NULL)
+      return update_row_array(target_var, head->rows[row_index], head->row_size, rbufs);
 
-   WL_APPEND(tail, function->name);
-   list = tail;
+   ARRAY *array = array_cell(target_var);
 
-   va_list args_list;
-   va_start(args_list, function);
-   const char *arg;
-   while ((arg = va_arg(args_list, const char*)))
-      WL_APPEND(tail, arg);
+   char number_buffer[32];
+   snprintf(number_buffer, sizeof(number_buffer), "%d", head->key_rows[row_index]);
 
-   va_end(args_list);
+   ARRAY_ELEMENT *target = reusable_row_elements(array, 2, rbufs);
+   if (target)
+   {
+      replace_element_value(target, head->rows[row_index]->value, row_buffer_at(rbufs, 0));
+      replace_element_value(target->next, number_buffer, row_buffer_at(rbufs, 1));
+   }
+   else
+   {
+      array_flush(array);
+      array_insert(array, 0, head->rows[row_index]->value);
+      array_insert(array, 1, number_buffer);
 
-   int cmd_flags = CMD_INHIBIT_EXPANSION | CMD_STDPATH;
+      if (rbufs)
+         row_buffers_record(rbufs, array);
+   }
 
-   COMMAND *command;
-   command = make_bare_simple_command();
-   command->value.Simple->words = list;
-   command->value.Simple->redirects = (REDIRECT*)NULL;
-   command->flags = command->value.Simple->flags = cmd_flags;
+   return EXECUTION_SUCCESS;
+}
 
-   return execute_command(command);
+/**
+ * @brief Parse a projection, a comma-separated list of column indexes
+ *
+ * Columns may be listed in any order, and more than once.  The
+ * projection is a single block to be released with `xfree`.
+ *
+ * @param "projection" [out] new projection
+ * @param "str"        [in]  column list, like "0,4,7"
+ * @param "row_size"   [in]  row size of the table to be projected
+ * @param "action"     [in]  action name for error messages
+ * @return EXECUTION_SUCCESS or EX_USAGE
+ */
+int row_projection_parse(RPROJ **projection, const char *str, int row_size, const char *action)
+{
+   int count = 1;
+   for (const char *ptr = str; *ptr; ++ptr)
+      if (*ptr == ',')
+         ++count;
+
+   // The fields follow the columns, aligned for pointers
+   size_t columns_size = count * sizeof(int);
+   columns_size += (sizeof(ARRAY_ELEMENT*) - columns_size % sizeof(ARRAY_ELEMENT*))
+      % sizeof(ARRAY_ELEMENT*);
+
+   RPROJ *new_proj = (RPROJ*)xmalloc(sizeof(RPROJ)
+                                     + columns_size
+                                     + row_size * sizeof(ARRAY_ELEMENT*));
+   new_proj->count = count;
+   new_proj->span = 0;
+   new_proj->fields = (ARRAY_ELEMENT**)((char*)new_proj->columns + columns_size);
+
+   const char *ptr = str;
+   for (int i=0; i < count; ++i)
+   {
+      char *end;
+      long column = strtol(ptr, &end, 10);
+      if (!isdigit((unsigned char)*ptr) || (*end && *end != ','))
+      {
+         ate_register_error("projection '%s' must be a list of column indexes in '%s'",
+                            str, action);
+         goto abandon_projection;
+      }
+
+      if (column >= row_size)
+      {
+         ate_register_error("projection column %ld is out of range for row size %d in '%s'",
+                            column, row_size, action);
+         goto abandon_projection;
+      }
+
+      new_proj->columns[i] = (int)column;
+      if (column >= new_proj->span)
+         new_proj->span = (int)column + 1;
+
+      ptr = *end ? end + 1 : end;
+   }
+
+   *projection = new_proj;
+   return EXECUTION_SUCCESS;
+
+  abandon_projection:
+   xfree(new_proj);
+   return EX_USAGE;
 }
 
 /**
- * @brief Invoke a shell function with a word list
- * @param "function"  [in] validated shell function variable
- * @param "wl"        [in] a word list of arguments to submit
- *                         to the shell function.
- * @return EXECUTION_SUCCESS or a non-zero error value if it fails.
+ * @brief Collect the fields of a row up to its last projected column
+ *        into the projection's `fields`.
+ * @return False if the row is incomplete
  */
-int invoke_shell_function_word_list(SHELL_VAR *function, WORD_LIST *wl)
+bool row_projection_gather(RPROJ *projection, ARRAY_ELEMENT *row)
 {
-   WORD_LIST *params = NULL;
-   WL_APPEND(params, function->name);
-   params->next = wl;
+   for (int i=0; i < projection->span; ++i)
+   {
+      if (row == NULL)
+         return False;
 
-   int cmd_flags = CMD_INHIBIT_EXPANSION | CMD_STDPATH;
+      projection->fields[i] = row;
+      row = row->next;
+   }
 
-   COMMAND *command;
-   command = make_bare_simple_command();
-   command->value.Simple->words = params;
-   command->value.Simple->redirects = (REDIRECT*)NULL;
-   command->flags = command->value.Simple->flags = cmd_flags;
+   return True;
+}
 
-   return execute_command(command);
+/**
+ * @brief Fill an array with the projected columns of a row
+ *
+ * As with @ref update_row_array, the array's elements are reused
+ * from one row to the next.
+ *
+ * @param "target_var"  [in,out] array to receive the columns
+ * @param "source_row"  [in]     first element of the row
+ * @param "projection"  [in]     columns to copy
+ * @param "rbufs"       [in,out] buffers of @p target_var, or NULL
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+int update_projected_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, RPROJ *projection, RBUFS *rbufs)
+{
+   if (!row_projection_gather(projection, source_row))
+   {
+      ate_register_error("corrupted table: incomplete row");
+      return EX_USAGE;
+   }
+
+   ARRAY *array = array_cell(target_var);
+   ARRAY_ELEMENT *target = reusable_row_elements(array, projection->count, rbufs);
+   bool rebuild = target == NULL;
+   if (rebuild)
+      array_flush(array);
+
+   for (int i=0; i < projection->count; ++i)
+   {
+      const char *value = projection->fields[projection->columns[i]]->value;
+      if (!rebuild)
+      {
+         replace_element_value(target, value, row_buffer_at(rbufs, i));
+         target = target->next;
+      }
+      else
+         array_insert(array, i, (char*)value);
+   }
+
+   if (rebuild && rbufs)
+      row_buffers_record(rbufs, array);
+
+   return EXECUTION_SUCCESS;
+}
+
+/**
+ * @brief Prepare a shell function to be called repeatedly with the
+ *        same arguments
+ *
+ * Actions that call a function for every row or comparison prepare
+ * the call once, saving the allocation and parsing of a COMMAND for
+ * each call.  The arguments can change between calls if the
+ * WORD_DESC buffers are changed in place, as `walk_rows` does for
+ * its row index.
+ *
+ * @param "pfunc"     [out] prepared function to initialize
+ * @param "function"  [in]  validated shell function variable
+ * @param "wl"        [in]  arguments to submit to the function, which
+ *                          must outlive @p pfunc
+ */
+void prepare_shell_function(PREPFUNC *pfunc, SHELL_VAR *function, WORD_LIST *wl)
+{
+   // One block for the WORD_LIST, WORD_DESC and name, as in a WLE:
+   WORD_LIST *words = (WORD_LIST*)xmalloc(WL_SIZE(function->name));
+   memset(words, 0, WL_SIZE(function->name));
+   WL_INITBLOCK(words, function->name);
+   words->next = wl;
+
+   pfunc->words = words;
+}
+
+/**
+ * @brief Call a function prepared with @ref prepare_shell_function
+ *
+ * The function is found by name for each call because the callback
+ * may unset or redefine itself, which frees the SHELL_VAR that was
+ * current when the call was prepared.
+ *
+ * @param "pfunc"  [in] prepared function
+ * @return the function's exit status, or EX_NOTFOUND if the function
+ *         no longer exists
+ */
+int invoke_prepared_function(const PREPFUNC *pfunc)
+{
+   const char *name = pfunc->words->word->word;
+   SHELL_VAR *function = find_function(name);
+   if (function == NULL)
+   {
+      ate_register_error("function '%s' was unset during the action", name);
+      return EX_NOTFOUND;
+   }
+
+   return execute_shell_function(function, pfunc->words);
+}
+
+/**
+ * @brief Release the memory of a prepared function.
+ *
+ * Safe to call on a zero-filled PREPFUNC, so it can be used at the
+ * early exit of an action before the function has been prepared.
+ */
+void release_prepared_function(PREPFUNC *pfunc)
+{
+   if (pfunc->words)
+   {
+      xfree(pfunc->words);
+      pfunc->words = NULL;
+   }
 }
 
 
@@ -787,6 +1116,42 @@ int get_handle_var_by_name_or_fail(SHELL_VAR **rvar,
    return retval;
 }
 
+/**
+ * @brief Secure a handle variable whose rows are copies of table rows.
+ *
+ * Like get_handle_var_by_name_or_fail(), but also rejects the handle
+ * of a native key (make_key -n), whose rows point at the source key
+ * fields rather than at full table rows.  Actions that read or change
+ * whole rows use this instead of get_handle_var_by_name_or_fail().
+ *
+ * @param "rvar"  [out]  place to return the variable, if found
+ * @param "name"  [in]   name of sought variable
+ * @param "action" [in]  name of action for registering any errors
+ * @return EXECUTION_SUCCESS if a table handle was found and returned,
+ *         EX_USAGE if not.
+ */
+int get_table_handle_var_by_name_or_fail(SHELL_VAR **rvar,
+                                         const char *name,
+                                         const char *action)
+{
+   SHELL_VAR *sv = NULL;
+   int retval = get_handle_var_by_name_or_fail(&sv, name, action);
+   if (retval == EXECUTION_SUCCESS)
+   {
+      AHEAD *ahead = ahead_cell(sv);
+      if (ahead->key_rows)
+      {
+         ate_register_error("native key '%s' (make_key -n) cannot be used in action '%s'",
+                            name, action);
+         retval = EX_USAGE;
+      }
+      else
+         *rvar = sv;
+   }
+
+   return retval;
+}
+
 /**
  * @brief Secure an `output` handle variable by a given name.
  *
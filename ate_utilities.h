@@ -37,14 +37,60 @@ void ate_dispose_variable_value(SHELL_VAR *var);
 int reindex_array_elements(AHEAD *head);
 
 ARRAY_ELEMENT *get_end_of_row(ARRAY_ELEMENT *row, int row_size);
+const char *get_row_field(ARRAY_ELEMENT *row, int column);
 
 int table_extend_rows(AHEAD *head, int new_columns, const char *fill_value);
 int table_contract_rows(AHEAD *head, int field_to_remove);
 
-int update_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, int row_size);
+/**
+ * @brief Value buffer given to an element of a callback's row array
+ */
+typedef struct row_buffer {
+   const ARRAY_ELEMENT *element;  ///< element holding the buffer
+   const char          *value;    ///< the buffer, as written to the element
+   size_t              length;    ///< length of the value last written
+   size_t              capacity;  ///< allocated size of the buffer
+} RBUF;
+
+/**
+ * @brief Buffers of a callback's row array, kept for the duration of
+ *        an action so values can be written in place
+ */
+typedef struct row_buffers {
+   int   count;     ///< number of recorded buffers
+   int   limit;     ///< number of allocated RBUF entries
+   RBUF  *buffers;
+} RBUFS;
+
+void row_buffers_release(RBUFS *rbufs);
 
-int invoke_shell_function(SHELL_VAR *function, ...);
-int invoke_shell_function_word_list(SHELL_VAR *function, WORD_LIST *wl);
+int update_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, int row_size, RBUFS *rbufs);
+int update_head_row_array(SHELL_VAR *target_var, const AHEAD *head, int row_index, RBUFS *rbufs);
+
+/**
+ * @brief Columns of a row to copy to a callback array, in order
+ */
+typedef struct row_projection {
+   int            count;    ///< number of projected columns
+   int            span;     ///< number of fields up to the last projected column
+   ARRAY_ELEMENT  **fields; ///< first @p span fields of the current row
+   int            columns[];
+} RPROJ;
+
+int row_projection_parse(RPROJ **projection, const char *str, int row_size, const char *action);
+bool row_projection_gather(RPROJ *projection, ARRAY_ELEMENT *row);
+int update_projected_row_array(SHELL_VAR *target_var, ARRAY_ELEMENT *source_row, RPROJ *projection, RBUFS *rbufs);
+
+/**
+ * @brief A shell function call prepared once to be invoked many times
+ */
+typedef struct prepared_function {
+   WORD_LIST *words;     ///< function name followed by the arguments
+} PREPFUNC;
+
+void prepare_shell_function(PREPFUNC *pfunc, SHELL_VAR *function, WORD_LIST *wl);
+int invoke_prepared_function(const PREPFUNC *pfunc);
+void release_prepared_function(PREPFUNC *pfunc);
 
 /**
  * @addtogroup ARG_VARS Functions for getting or creating SHELL_VARs
@@ -76,6 +122,10 @@ int get_handle_var_by_name_or_fail(SHELL_VAR **rvar,
                                    const char *name,
                                    const char *action);
 
+int get_table_handle_var_by_name_or_fail(SHELL_VAR **rvar,
+                                         const char *name,
+                                         const char *action);
+
 int create_handle_by_name_or_fail(SHELL_VAR **rvar,
                                   const char *name,
                                   AHEAD *ahead,
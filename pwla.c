@@ -8,6 +8,7 @@
 #include "pwla.h"
 #include "ate_errors.h"
 #include <stdio.h>
+#include <string.h>
 
 /**
  * @brief Called by @ref process_word_list_args to get the matching option target.
@@ -88,7 +89,10 @@ int process_word_list_args(ARG_TARGET *targets, ARG_LIST *args_handle, AL_FLAGS
    while (arg_handle->next)
    {
       const char *arg_val = arg_handle->next->value;
-      if (cease_options == 0 && arg_val[0] == '-' && arg_val[1])
+      // Where options end with the last argument target, '--' is an
+      // argument, like the placeholder new handle name of 'sort'
+      if (cease_options == 0 && arg_val[0] == '-' && arg_val[1]
+          && !(flags == AL_ARGS_END_OPTIONS && 0 == strcmp(arg_val, "--")))
       {
          const char *cur_option = &arg_val[1];
 
@@ -181,6 +185,11 @@ int process_word_list_args(ARG_TARGET *targets, ARG_LIST *args_handle, AL_FLAGS
 
       arg_handle->next = arg_handle->next->next;
 
+      // Leave arguments that follow the last argument target, even
+      // those that look like options, for follow-on processing
+      if (flags == AL_ARGS_END_OPTIONS && !pwla_next_arg_target(targets))
+         cease_options = 1;
+
      skip_argument_increment:
       continue;
    }
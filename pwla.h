@@ -85,6 +85,7 @@ typedef enum {
    AL_NOTIFY_MISSING,   ///< notify for any missing arguments
    AL_NOTIFY_UNKNOWN,   ///< notify for unknown options
    AL_NO_OPTIONS,       ///< treat options as regular arguments
+   AL_ARGS_END_OPTIONS, ///< treat options after the last argument target as arguments
    AL_END               ///< bounds-confirming value
 } AL_FLAGS;
 
@@ -142,6 +143,20 @@ int pwla_sort(ARG_LIST *alist);
 int pwla_filter(ARG_LIST *alist);
 int pwla_make_key(ARG_LIST *alist);
 int pwla_seek_key(ARG_LIST *alist);
+int pwla_top_k(ARG_LIST *alist);
+int pwla_merge_new_rows(ARG_LIST *alist);
+int pwla_make_hash(ARG_LIST *alist);
+int pwla_seek_hash(ARG_LIST *alist);
+
+// seek_range and seek_prefix share pwla_seek_range.c:
+int pwla_seek_range(ARG_LIST *alist);
+int pwla_seek_prefix(ARG_LIST *alist);
+
+int pwla_make_glob_index(ARG_LIST *alist);
+int pwla_match_glob(ARG_LIST *alist);
+int pwla_join(ARG_LIST *alist);
+int pwla_aggregate(ARG_LIST *alist);
+int pwla_distinct(ARG_LIST *alist);
 
 /** @} */
 
@@ -116,9 +116,9 @@ int pwla_append_data(ARG_LIST *alist)
       goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "append_data")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "append_data")))
       goto early_exit;
 
    AHEAD *ahead = ahead_cell(handle_var);
@@ -187,9 +187,9 @@ int pwla_index_rows(ARG_LIST *alist)
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "index_rows")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "index_rows")))
       goto early_exit;
 
    // Do the job
@@ -409,9 +409,9 @@ int pwla_get_field_sizes(ARG_LIST *alist)
    }
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "get_field_sizes")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "get_field_sizes")))
       goto early_exit;
 
    SHELL_VAR *array_var;
@@ -524,6 +524,13 @@ int pwla_get_row(ARG_LIST *alist)
       goto early_exit;
    }
 
+   // A native key's rows are not copied from elements
+   if (ahead->key_rows)
+   {
+      retval = update_head_row_array(array_var, ahead, row_index, NULL);
+      goto early_exit;
+   }
+
    ARRAY_ELEMENT *source_el = ahead->rows[row_index];
    ARRAY *target_array = array_cell(array_var);
    array_flush(target_array);
@@ -576,9 +583,9 @@ int pwla_put_row(ARG_LIST *alist)
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "put_row")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "put_row")))
       goto early_exit;
 
    // Need ahead of time to validate values
@@ -669,9 +676,9 @@ int pwla_resize_rows(ARG_LIST *alist)
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "resize_rows")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "resize_rows")))
       goto early_exit;
 
    retval = EX_USAGE;
@@ -740,9 +747,9 @@ int pwla_reindex_elements(ARG_LIST *alist)
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "resize_rows")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "reindex_elements")))
       goto early_exit;
 
    AHEAD *ahead = ahead_cell(handle_var);
@@ -60,24 +60,72 @@ struct pwla_action_def pwla_actions[] = {
      pwla_reindex_elements },
 
    { "walk_rows", "invoke a callback with each of a table's rows",
-     "ate walk_rows handle_name function_name [-s start] [-c count] [extra ...]",
+     "ate walk_rows handle_name function_name [-L] [-s start] [-c count] [-b batch_size] [-p projection] [extra ...]",
      pwla_walk_rows },
 
    { "sort", "create a duplicate handle with a sorted order",
-     "ate sort handle_name comparison_function new_handle_name [extra ...]",
+     "ate sort handle_name [-p projection] comparison_function new_handle_name [extra ...]\n"
+     "  ate sort handle_name [-l] -k sort_spec [new_handle_name]\n"
+     "  ate sort handle_name [-l] [-p projection] -K key_function [new_handle_name] [extra ...]",
      pwla_sort },
 
    { "filter", "create a duplicate handle with filtered contents",
-     "ate filter handle_name filter_function new_handle_name [extra ...]",
+     "ate filter handle_name [-p projection] filter_function new_handle_name [extra ...]",
      pwla_filter },
 
    { "make_key", "create an key handle linking strings to row indexes",
-     "ate make_key handle_name tag_function new_handle_name[extra ...]",
+     "ate make_key handle_name new_handle_name [-c column_list] [-i] [-r] [-l] [-E] [-n] [-B bits_per_key]\n"
+     "  ate make_key handle_name new_handle_name [-i] [-r] [-l] [-E] [-B bits_per_key] [-p projection] -f set_key_function [extra ...]",
      pwla_make_key },
 
    { "seek_key", "return key_handle row number of equal or greater key",
-     "ate seek_key handle_name target_value -p -s [-v value] [-t tally_name]",
-     pwla_seek_key }
+     "ate seek_key handle_name target_value -p -s [-v value] [-t tally_name]\n"
+     "  ate seek_key handle_name -A search_array [-a results_array] -p -s [-t tally_name]",
+     pwla_seek_key },
+
+   { "top_k", "create a handle with the first rows of a sorted order",
+     "ate top_k handle_name -k sort_spec -n row_limit new_handle_name",
+     pwla_top_k },
+
+   { "merge_new_rows", "merge rows added to a table into a sorted or key handle",
+     "ate merge_new_rows sorted_handle_name source_handle_name",
+     pwla_merge_new_rows },
+
+   { "make_hash", "create a handle with a hash index of a column",
+     "ate make_hash handle_name new_handle_name [-c column_index]",
+     pwla_make_hash },
+
+   { "seek_hash", "return the row number(s) of a hashed column value",
+     "ate seek_hash hash_handle_name search_value [-v value] [-o outcome] [-a array]",
+     pwla_seek_hash },
+
+   { "seek_range", "return start and count of key rows in a range of values",
+     "ate seek_range key_handle_name low_value high_value [-i] [-a array]",
+     pwla_seek_range },
+
+   { "seek_prefix", "return start and count of key rows beginning with a prefix",
+     "ate seek_prefix key_handle_name prefix [-a array]",
+     pwla_seek_prefix },
+
+   { "make_glob_index", "create a handle with an index of a column of glob patterns",
+     "ate make_glob_index handle_name new_handle_name [-c column_index]",
+     pwla_make_glob_index },
+
+   { "match_glob", "return the row number of the first glob pattern matching a string",
+     "ate match_glob glob_handle_name string [-v value] [-o outcome]",
+     pwla_match_glob },
+
+   { "join", "create a table of the rows of two handles with equal column values",
+     "ate join left_handle left_column right_handle right_column new_handle_name [-t type] [-a array]",
+     pwla_join },
+
+   { "aggregate", "create a table of counts, sums, minimums, maximums or averages of groups of rows",
+     "ate aggregate handle_name [-g group_columns] -a aggregate_list new_handle_name",
+     pwla_aggregate },
+
+   { "distinct", "create a handle with the first or last row of each distinct key",
+     "ate distinct handle_name [-c columns] [-k first|last] new_handle_name",
+     pwla_distinct }
 };
 
 /**
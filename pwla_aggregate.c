@@ -0,0 +1,498 @@
+/**
+ * @file pwla_aggregate.c
+ * @brief `aggregate` action implementation
+ *
+ * Rows are gathered into groups of equal group column values with a
+ * hash table, and the count, sum, minimum, maximum or average of
+ * columns of each group are accumulated in C.  Each group becomes a
+ * row of a new table.
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+#include "ate_hash.h"
+
+/**
+ * @brief Aggregate functions, named in the `-a` list
+ */
+typedef enum {
+   AGG_COUNT = 0,  ///< number of rows in the group
+   AGG_SUM,        ///< sum of the integers of a column
+   AGG_MIN,        ///< least integer of a column
+   AGG_MAX,        ///< greatest integer of a column
+   AGG_AVG         ///< average of the integers of a column
+} AGG_FUNC;
+
+/**
+ * @brief One item of the `-a` list
+ */
+typedef struct aggregate_item {
+   AGG_FUNC func;    ///< function to compute
+   int      column;  ///< column of the values, unused by AGG_COUNT
+} AGGITEM;
+
+/**
+ * @brief Running totals of one aggregate item for one group.  Fields
+ *        that are not integers are left out of the totals.
+ */
+typedef struct aggregate_total {
+   long sum;         ///< sum of the integer values
+   long min;         ///< least integer value, if @p count > 0
+   long max;         ///< greatest integer value, if @p count > 0
+   int  count;       ///< number of integer values
+} AGGTOTAL;
+
+/**
+ * @brief Groups of rows with equal group column values, in order of
+ *        the first row of each group
+ */
+typedef struct aggregate_groups {
+   int         group_size;  ///< number of group columns
+   int         item_count;  ///< number of aggregate items
+   int         count;       ///< number of groups
+   int         capacity;    ///< number of groups for which memory is allocated
+   const char  **values;    ///< group column values of each group
+   int         *row_counts; ///< number of rows in each group
+   uint32_t    *hashes;     ///< hash of the group values of each group
+   AGGTOTAL    *totals;     ///< totals of each item of each group
+   uint32_t    mask;        ///< number of @p slots minus one (a power of two)
+   int32_t     *slots;      ///< group of each slot, or -1 if empty
+} AGROUPS;
+
+/**
+ * @brief Parse the `-a` list of aggregates, like `count,sum:3,avg:3`
+ * @param "items"    [out] new vector of items, to be released with `xfree`
+ * @param "count"    [out] number of items
+ * @param "str"      [in]  the aggregate list
+ * @param "row_size" [in]  number of fields in a row, for validating columns
+ * @return EXECUTION_SUCCESS or EX_USAGE
+ */
+static int aggregate_parse_items(AGGITEM **items, int *count, const char *str, int row_size)
+{
+   static const char *names[] = { "count", "sum", "min", "max", "avg" };
+
+   int item_count = 1;
+   for (const char *ptr = str; *ptr; ++ptr)
+      if (*ptr == ',')
+         ++item_count;
+
+   AGGITEM *new_items = (AGGITEM*)xmalloc(item_count * sizeof(AGGITEM));
+
+   const char *ptr = str;
+   for (int i=0; i < item_count; ++i)
+   {
+      size_t len = strcspn(ptr, ",:");
+      int func = 0;
+      while (func < (int)(sizeof(names) / sizeof(names[0]))
+             && (strlen(names[func]) != len || strncmp(ptr, names[func], len)))
+         ++func;
+
+      if (func == (int)(sizeof(names) / sizeof(names[0])))
+      {
+         ate_register_error("unknown aggregate '%.*s' in '%s' in 'aggregate'", (int)len, ptr, str);
+         goto abandon_items;
+      }
+
+      new_items[i].func = (AGG_FUNC)func;
+      new_items[i].column = 0;
+      ptr += len;
+
+      if (func == AGG_COUNT)
+      {
+         if (*ptr == ':')
+         {
+            ate_register_error("aggregate 'count' takes no column in '%s' in 'aggregate'", str);
+            goto abandon_items;
+         }
+      }
+      else
+      {
+         char *end;
+         if (*ptr != ':' || !isdigit((unsigned char)ptr[1]))
+         {
+            ate_register_error("aggregate '%s' needs a column, like '%s:2', in 'aggregate'",
+                               names[func], names[func]);
+            goto abandon_items;
+         }
+
+         new_items[i].column = (int)strtol(ptr + 1, &end, 10);
+         if (new_items[i].column >= row_size)
+         {
+            ate_register_error("aggregate column %d is out of range for row size %d in 'aggregate'",
+                               new_items[i].column, row_size);
+            goto abandon_items;
+         }
+         ptr = end;
+      }
+
+      if (*ptr == ',')
+         ++ptr;
+      else if (*ptr)
+      {
+         ate_register_error("unexpected '%s' in aggregate list '%s' in 'aggregate'", ptr, str);
+         goto abandon_items;
+      }
+   }
+
+   *items = new_items;
+   *count = item_count;
+   return EXECUTION_SUCCESS;
+
+  abandon_items:
+   xfree(new_items);
+   return EX_USAGE;
+}
+
+/**
+ * @brief Hash of the group values of a row
+ */
+static uint32_t aggregate_hash(const char **values, int count)
+{
+   uint32_t hash = HASH_FNV_OFFSET;
+   for (int i=0; i < count; ++i)
+      hash = hash_add_value(hash, values[i]);
+   return hash;
+}
+
+/**
+ * @brief Enlarge the group vectors, and the slots to keep them at most
+ *        half full
+ */
+static void aggregate_grow(AGROUPS *groups)
+{
+   groups->capacity = groups->capacity ? groups->capacity * 2 : 64;
+   int capacity = groups->capacity;
+
+   // Without group columns, there are no group values to save
+   int value_count = groups->group_size ? groups->group_size : 1;
+   groups->values = (const char**)xrealloc(groups->values,
+                                           (size_t)capacity * value_count * sizeof(char*));
+   groups->row_counts = (int*)xrealloc(groups->row_counts, capacity * sizeof(int));
+   groups->hashes = (uint32_t*)xrealloc(groups->hashes, capacity * sizeof(uint32_t));
+   groups->totals = (AGGTOTAL*)xrealloc(groups->totals,
+                                        (size_t)capacity * groups->item_count * sizeof(AGGTOTAL));
+
+   // Rehash the groups into the slots for the new capacity
+   uint32_t slot_count = hash_slot_count(capacity);
+   groups->mask = slot_count - 1;
+   if (groups->slots)
+      xfree(groups->slots);
+   groups->slots = (int32_t*)xmalloc(slot_count * sizeof(int32_t));
+   memset(groups->slots, -1, slot_count * sizeof(int32_t));
+
+   for (int group=0; group < groups->count; ++group)
+   {
+      uint32_t slot = groups->hashes[group] & groups->mask;
+      while (groups->slots[slot] >= 0)
+         slot = (slot + 1) & groups->mask;
+      groups->slots[slot] = group;
+   }
+}
+
+/**
+ * @brief Find the group of a row's group values, adding a new group
+ *        if there is none
+ * @return index of the group
+ */
+static int aggregate_find_group(AGROUPS *groups, const char **values)
+{
+   int size = groups->group_size;
+   uint32_t hash = aggregate_hash(values, size);
+   uint32_t slot = hash & groups->mask;
+
+   int32_t group;
+   while ((group = groups->slots[slot]) >= 0)
+   {
+      if (groups->hashes[group] == hash)
+      {
+         const char **group_values = &groups->values[(size_t)group * size];
+         int i = 0;
+         while (i < size && 0 == strcmp(group_values[i], values[i]))
+            ++i;
+         if (i == size)
+            return group;
+      }
+
+      slot = (slot + 1) & groups->mask;
+   }
+
+   if (groups->count == groups->capacity)
+   {
+      aggregate_grow(groups);
+      slot = hash & groups->mask;
+      while (groups->slots[slot] >= 0)
+         slot = (slot + 1) & groups->mask;
+   }
+
+   group = groups->count++;
+   groups->slots[slot] = group;
+   groups->hashes[group] = hash;
+   groups->row_counts[group] = 0;
+   memcpy(&groups->values[(size_t)group * size], values, size * sizeof(char*));
+   memset(&groups->totals[(size_t)group * groups->item_count], 0,
+          groups->item_count * sizeof(AGGTOTAL));
+
+   return group;
+}
+
+/**
+ * @brief Convert a field to an integer only if the whole field is an
+ *        integer that fits in a long, so "3.5", "12kg" and "1e6" are
+ *        left out of the totals instead of counted as 3, 12 and 1
+ * @return True if @p str is an integer
+ */
+static bool aggregate_get_long(long *value, const char *str)
+{
+   char *end;
+   errno = 0;
+   long val = strtol(str, &end, 10);
+   if (end == str || *end != '\0' || errno == ERANGE)
+      return False;
+
+   *value = val;
+   return True;
+}
+
+/**
+ * @brief Add an integer value to the totals of an item
+ * @return False if the sum would overflow, leaving the sum unchanged
+ */
+static bool aggregate_add_value(AGGTOTAL *total, long value)
+{
+   if (total->count == 0)
+      total->min = total->max = value;
+   else if (value < total->min)
+      total->min = value;
+   else if (value > total->max)
+      total->max = value;
+
+   ++total->count;
+
+   if ((value > 0 && total->sum > LONG_MAX - value)
+       || (value < 0 && total->sum < LONG_MIN - value))
+      return False;
+
+   total->sum += value;
+   return True;
+}
+
+/**
+ * @brief Release the memory of the groups
+ */
+static void aggregate_free_groups(AGROUPS *groups)
+{
+   if (groups->values)
+      xfree(groups->values);
+   if (groups->row_counts)
+      xfree(groups->row_counts);
+   if (groups->hashes)
+      xfree(groups->hashes);
+   if (groups->totals)
+      xfree(groups->totals);
+   if (groups->slots)
+      xfree(groups->slots);
+}
+
+/**
+ * @brief Format the value of an aggregate item of a group
+ * @return @p buffer, or an empty string if there is no value
+ */
+static const char *aggregate_format(char *buffer,
+                                    size_t size,
+                                    const AGGITEM *item,
+                                    const AGGTOTAL *total,
+                                    int row_count)
+{
+   if (item->func == AGG_COUNT)
+      snprintf(buffer, size, "%d", row_count);
+   else if (item->func == AGG_SUM)
+      snprintf(buffer, size, "%ld", total->sum);
+   else if (total->count == 0)
+      return "";
+   else if (item->func == AGG_MIN)
+      snprintf(buffer, size, "%ld", total->min);
+   else if (item->func == AGG_MAX)
+      snprintf(buffer, size, "%ld", total->max);
+   else
+      snprintf(buffer, size, "%.15g", (double)total->sum / total->count);
+
+   return buffer;
+}
+
+/**
+ * @brief Make a table of the aggregates of groups of rows
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_aggregate(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *new_handle_name = NULL;
+   const char *group_string = NULL;
+   const char *aggregate_string = NULL;
+
+   ARG_TARGET aggregate_targets[] = {
+      { "handle_name",     AL_ARG, &handle_name},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { "g",               AL_OPT, &group_string},
+      { "a",               AL_OPT, &aggregate_string},
+      { NULL }
+   };
+
+   int retval;
+
+   // Checked on early exit, must be initialized
+   SSPEC *group_spec = NULL;
+   AGGITEM *items = NULL;
+   const char **fields = NULL;
+   AGROUPS groups;
+   memset(&groups, 0, sizeof(groups));
+
+   if ((retval = process_word_list_args(aggregate_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "aggregate")))
+      goto early_exit;
+
+   retval = EX_USAGE;
+
+   if (new_handle_name == NULL)
+   {
+      ate_register_missing_argument("new_handle_name", "aggregate");
+      goto early_exit;
+   }
+
+   AHEAD *ahead = ahead_cell(handle_var);
+   if (ahead->row_size < 1)
+   {
+      ate_register_error("handle '%s' has no row size for 'aggregate'", handle_name);
+      goto early_exit;
+   }
+
+   if (aggregate_string == NULL)
+   {
+      ate_register_missing_argument("-a aggregate_list", "aggregate");
+      goto early_exit;
+   }
+
+   // Group columns are written like a sort specification, without modifiers
+   if (group_string)
+   {
+      if ((retval = sort_spec_parse(&group_spec, group_string, ahead->row_size, "aggregate")))
+         goto early_exit;
+
+      retval = EX_USAGE;
+      for (int i=0; i < group_spec->count; ++i)
+      {
+         const SCOL *col = &group_spec->columns[i];
+         if (col->numeric || col->reverse || col->collate)
+         {
+            ate_register_error("group columns '%s' cannot have modifiers in 'aggregate'",
+                               group_string);
+            goto early_exit;
+         }
+      }
+   }
+
+   if ((retval = aggregate_parse_items(&items, &groups.item_count, aggregate_string, ahead->row_size)))
+      goto early_exit;
+
+   groups.group_size = group_spec ? group_spec->count : 0;
+   aggregate_grow(&groups);
+
+   // Fields of the current row, by column
+   fields = (const char**)xmalloc((ahead->row_size + groups.group_size) * sizeof(char*));
+   const char **group_values = &fields[ahead->row_size];
+
+   // Without group columns, every row is in one group, even if there are no rows
+   if (groups.group_size == 0)
+      aggregate_find_group(&groups, group_values);
+
+   for (int row=0; row < ahead->row_count; ++row)
+   {
+      ARRAY_ELEMENT *field = ahead->rows[row];
+      for (int i=0; i < ahead->row_size; ++i, field = field->next)
+         fields[i] = field->value ? field->value : "";
+
+      for (int i=0; i < groups.group_size; ++i)
+         group_values[i] = fields[group_spec->columns[i].column];
+
+      int group = aggregate_find_group(&groups, group_values);
+      ++groups.row_counts[group];
+
+      AGGTOTAL *totals = &groups.totals[(size_t)group * groups.item_count];
+      for (int i=0; i < groups.item_count; ++i)
+      {
+         long value;
+         if (items[i].func != AGG_COUNT
+             && aggregate_get_long(&value, fields[items[i].column])
+             && !aggregate_add_value(&totals[i], value)
+             && (items[i].func == AGG_SUM || items[i].func == AGG_AVG))
+         {
+            ate_register_error("the sum of column %d overflows a long integer in 'aggregate'",
+                               items[i].column);
+            retval = EXECUTION_FAILURE;
+            goto early_exit;
+         }
+      }
+   }
+
+   SHELL_VAR *array_var;
+   if ((retval = create_array_var_by_stem(&array_var, "ATE_HOSTED_ARRAY_", "aggregate")))
+      goto early_exit;
+
+   ARRAY *array = array_cell(array_var);
+   arrayind_t index = 0;
+   char number_buffer[32];
+
+   for (int group=0; group < groups.count; ++group)
+   {
+      for (int i=0; i < groups.group_size; ++i)
+         array_insert(array, index++, (char*)groups.values[(size_t)group * groups.group_size + i]);
+
+      const AGGTOTAL *totals = &groups.totals[(size_t)group * groups.item_count];
+      for (int i=0; i < groups.item_count; ++i)
+         array_insert(array, index++, (char*)aggregate_format(number_buffer,
+                                                              sizeof(number_buffer),
+                                                              &items[i],
+                                                              &totals[i],
+                                                              groups.row_counts[group]));
+   }
+
+   SHELL_VAR *new_handle_var = NULL;
+   if (ate_create_handle(&new_handle_var,
+                         new_handle_name,
+                         array_var,
+                         groups.group_size + groups.item_count))
+      retval = EXECUTION_SUCCESS;
+   else
+   {
+      ate_register_error("failed to create handle in action 'aggregate'");
+      retval = EXECUTION_FAILURE;
+   }
+
+  early_exit:
+   aggregate_free_groups(&groups);
+   if (fields)
+      xfree(fields);
+   if (items)
+      xfree(items);
+   if (group_spec)
+      xfree(group_spec);
+
+   return retval;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file pwla_distinct.c
+ * @brief `distinct` action implementation
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+#include "ate_hash.h"
+
+/**
+ * @brief Distinct combinations of the values of the chosen columns
+ */
+typedef struct distinct_keys {
+   const AHEAD *head;      ///< table whose rows are compared
+   const SSPEC *spec;      ///< columns to compare
+   uint32_t    mask;       ///< number of @p slots minus one (a power of two)
+   int32_t     *slots;     ///< first row of each distinct key, or -1 if empty
+   uint32_t    *hashes;    ///< hash of the key of each row
+} DKEYS;
+
+/**
+ * @brief Hash of the key values of a row
+ */
+static uint32_t distinct_hash(const DKEYS *keys, int row)
+{
+   uint32_t hash = HASH_FNV_OFFSET;
+   for (int i=0; i < keys->spec->count; ++i)
+      hash = hash_add_value(hash, get_row_field(keys->head->rows[row],
+                                                keys->spec->columns[i].column));
+   return hash;
+}
+
+/**
+ * @brief True if two rows have the same key
+ */
+static bool distinct_equal(const DKEYS *keys, int left, int right)
+{
+   for (int i=0; i < keys->spec->count; ++i)
+   {
+      int column = keys->spec->columns[i].column;
+      if (strcmp(get_row_field(keys->head->rows[left], column),
+                 get_row_field(keys->head->rows[right], column)))
+         return False;
+   }
+   return True;
+}
+
+/**
+ * @brief Find the first row with the key of @p row, adding @p row as
+ *        the first of a new key if there is none
+ * @return the slot of the key
+ */
+static uint32_t distinct_find(DKEYS *keys, int row)
+{
+   uint32_t hash = keys->hashes[row] = distinct_hash(keys, row);
+   uint32_t slot = hash & keys->mask;
+
+   int32_t first;
+   while ((first = keys->slots[slot]) >= 0)
+   {
+      if (keys->hashes[first] == hash && distinct_equal(keys, first, row))
+         return slot;
+
+      slot = (slot + 1) & keys->mask;
+   }
+
+   keys->slots[slot] = row;
+   return slot;
+}
+
+/**
+ * @brief Create a new handle with one row of each distinct key
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_distinct(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *new_handle_name = NULL;
+   const char *column_string = NULL;
+   const char *keep_string = NULL;
+
+   ARG_TARGET distinct_targets[] = {
+      { "handle_name",     AL_ARG, &handle_name},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { "c",               AL_OPT, &column_string},
+      { "k",               AL_OPT, &keep_string},
+      { NULL }
+   };
+
+   int retval;
+
+   // Checked on early exit, must be initialized
+   SSPEC *spec = NULL;
+   DKEYS keys;
+   memset(&keys, 0, sizeof(keys));
+   int32_t *kept = NULL;
+   int32_t *row_slots = NULL;
+   AEL *ael_nodes = NULL;
+
+   if ((retval = process_word_list_args(distinct_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "distinct")))
+      goto early_exit;
+
+   retval = EX_USAGE;
+
+   if (new_handle_name == NULL)
+   {
+      ate_register_missing_argument("new_handle_name", "distinct");
+      goto early_exit;
+   }
+
+   AHEAD *ahead = ahead_cell(handle_var);
+   if (ahead->row_size < 1)
+   {
+      ate_register_error("handle '%s' has no row size for 'distinct'", handle_name);
+      goto early_exit;
+   }
+
+   bool keep_last = False;
+   if (keep_string)
+   {
+      if (0 == strcmp(keep_string, "last"))
+         keep_last = True;
+      else if (strcmp(keep_string, "first"))
+      {
+         ate_register_error("unknown -k value '%s' (first or last) in 'distinct'", keep_string);
+         goto early_exit;
+      }
+   }
+
+   // Columns are written like a sort specification, without modifiers.
+   // By default, entire rows are compared.
+   if (column_string)
+   {
+      if ((retval = sort_spec_parse(&spec, column_string, ahead->row_size, "distinct")))
+         goto early_exit;
+
+      retval = EX_USAGE;
+      for (int i=0; i < spec->count; ++i)
+      {
+         const SCOL *col = &spec->columns[i];
+         if (col->numeric || col->reverse || col->collate)
+         {
+            ate_register_error("columns '%s' cannot have modifiers in 'distinct'", column_string);
+            goto early_exit;
+         }
+      }
+   }
+   else
+   {
+      spec = (SSPEC*)xmalloc(sizeof(SSPEC) + ahead->row_size * sizeof(SCOL));
+      spec->count = ahead->row_size;
+      for (int i=0; i < ahead->row_size; ++i)
+      {
+         SCOL *col = &spec->columns[i];
+         col->column = col->source = i;
+         col->numeric = col->reverse = col->collate = False;
+      }
+   }
+
+   retval = EXECUTION_FAILURE;
+
+   int row_count = ahead->row_count;
+
+   uint32_t slot_count = hash_slot_count(row_count);
+
+   keys.head = ahead;
+   keys.spec = spec;
+   keys.mask = slot_count - 1;
+   keys.slots = (int32_t*)xmalloc(slot_count * sizeof(int32_t));
+   memset(keys.slots, -1, slot_count * sizeof(int32_t));
+   keys.hashes = (uint32_t*)xmalloc((row_count ? row_count : 1) * sizeof(uint32_t));
+
+   // The row kept for each key, by the slot of the key, and the
+   // slot of the key of each row
+   kept = (int32_t*)xmalloc(slot_count * sizeof(int32_t));
+   row_slots = (int32_t*)xmalloc((row_count ? row_count : 1) * sizeof(int32_t));
+
+   // Rows are compared to the first row of their keys, so the slots
+   // keep the first rows, and the kept rows are recorded separately.
+   for (int row=0; row < row_count; ++row)
+   {
+      uint32_t slot = distinct_find(&keys, row);
+      row_slots[row] = (int32_t)slot;
+      if (keys.slots[slot] == row || keep_last)
+         kept[slot] = row;
+   }
+
+   // A second pass finds the kept rows in table order
+   ael_nodes = (AEL*)xmalloc((row_count ? row_count : 1) * sizeof(AEL));
+   AEL *ael_list = NULL, *ael_tail = NULL;
+   int count = 0;
+   for (int row=0; row < row_count; ++row)
+   {
+      if (kept[row_slots[row]] == row)
+      {
+         AEL *ael_cur = &ael_nodes[count++];
+         ael_cur->element = ahead->rows[row];
+         ael_cur->next = NULL;
+         if (ael_tail)
+            ael_tail->next = ael_cur;
+         else
+            ael_list = ael_cur;
+
+         ael_tail = ael_cur;
+      }
+   }
+
+   AHEAD *new_head = NULL;
+   if (ate_create_head_with_ael(&new_head,
+                                ahead->array,
+                                ahead->row_size,
+                                count,
+                                ael_list))
+   {
+      SHELL_VAR *var = NULL;
+      if (ate_create_handle_with_head(&var,
+                                      new_handle_name,
+                                      new_head))
+         retval = EXECUTION_SUCCESS;
+      else
+         xfree(new_head);
+   }
+   else
+      ate_register_unexpected_error("creating the distinct handle");
+
+  early_exit:
+   if (ael_nodes)
+      xfree(ael_nodes);
+   if (row_slots)
+      xfree(row_slots);
+   if (kept)
+      xfree(kept);
+   if (keys.slots)
+      xfree(keys.slots);
+   if (keys.hashes)
+      xfree(keys.hashes);
+   if (spec)
+      xfree(spec);
+
+   return retval;
+}
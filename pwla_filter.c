@@ -22,6 +22,7 @@ int pwla_filter(ARG_LIST *alist)
    const char *handle_name = NULL;
    const char *function_name = NULL;
    const char *new_handle_name = NULL;
+   const char *projection_str = NULL;
 
    ARG_TARGET filter_targets[] = {
       { "handle_name",     AL_ARG, &handle_name},
@@ -30,15 +31,42 @@ int pwla_filter(ARG_LIST *alist)
       { NULL }
    };
 
+   ARG_TARGET filter_option_targets[] = {
+      { "handle_name",     AL_ARG, &handle_name},
+      { "p",               AL_OPT, &projection_str},
+      { "callback_name",   AL_ARG, &function_name},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { NULL }
+   };
+
    int retval;
 
-   if ((retval = process_word_list_args(filter_targets, alist, AL_NO_OPTIONS)))
+   // Checked on early exit, must be initialized
+   PREPFUNC callback;
+   memset(&callback, 0, sizeof(callback));
+   RPROJ *projection = NULL;
+   RBUFS row_buffers;
+   memset(&row_buffers, 0, sizeof(row_buffers));
+
+   // As with 'sort', options are only recognized if one immediately
+   // follows the handle name, and only until the new handle name is
+   // filled, so extra arguments for the callback function are never
+   // mistaken for options.
+   const char *second_arg = (alist->next && alist->next->next)
+      ? alist->next->next->value : NULL;
+
+   if (second_arg && second_arg[0] == '-' && 0 != strcmp(second_arg, "--"))
+   {
+      if ((retval = process_word_list_args(filter_option_targets, alist, AL_ARGS_END_OPTIONS)))
+         goto early_exit;
+   }
+   else if ((retval = process_word_list_args(filter_targets, alist, AL_NO_OPTIONS)))
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "filter")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "filter")))
       goto early_exit;
 
    SHELL_VAR *callback_var;
@@ -55,6 +83,13 @@ int pwla_filter(ARG_LIST *alist)
       goto early_exit;
    }
 
+   // Use the values aquired above
+   AHEAD *ahead = ahead_cell(handle_var);
+
+   if (projection_str
+       && (retval = row_projection_parse(&projection, projection_str, ahead->row_size, "filter")))
+      goto early_exit;
+
    // For actions that create an array for callback functions
    SHELL_VAR *new_array = NULL;
    if ((retval = create_array_var_by_stem(&new_array, "ATE_FILTER_ARRAY_", "template")))
@@ -70,9 +105,8 @@ int pwla_filter(ARG_LIST *alist)
       WL_APPEND(tail, argptr->value);
       argptr = argptr->next;
    }
+   prepare_shell_function(&callback, callback_var, args);
 
-   // Use the values aquired above
-   AHEAD *ahead = ahead_cell(handle_var);
    ARRAY_ELEMENT **ptr = ahead->rows;
    ARRAY_ELEMENT **end = ptr + ahead->row_count;
 
@@ -82,10 +116,15 @@ int pwla_filter(ARG_LIST *alist)
    while (ptr < end)
    {
       // Update new_array with current row contents:
-      if ((retval = update_row_array(new_array, *ptr, ahead->row_size)))
+      if (projection)
+         retval = update_projected_row_array(new_array, *ptr, projection, &row_buffers);
+      else
+         retval = update_row_array(new_array, *ptr, ahead->row_size, &row_buffers);
+
+      if (retval)
          goto early_exit;
 
-      if (EXECUTION_SUCCESS == invoke_shell_function_word_list(callback_var, args))
+      if (EXECUTION_SUCCESS == invoke_prepared_function(&callback))
       {
          ++count;
          ael_cur = (AEL*)alloca(sizeof(AEL));
@@ -122,6 +161,10 @@ int pwla_filter(ARG_LIST *alist)
    }
 
   early_exit:
+   row_buffers_release(&row_buffers);
+   release_prepared_function(&callback);
+   if (projection)
+      xfree(projection);
    return retval;
 }
 
@@ -0,0 +1,437 @@
+/**
+ * @file pwla_join.c
+ * @brief `join` action implementation
+ *
+ * The rows of two handles with equal values in a column of each are
+ * found in C, by a hash of one handle's column or by merging two
+ * handles sorted by their columns, and the joined rows are copied to
+ * a new table.
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+#include "ate_hash.h"
+
+/**
+ * @brief Kinds of join, named by the `-t` option
+ */
+typedef enum {
+   JOIN_INNER = 0,   ///< every pair of matching left and right rows
+   JOIN_LEFT,        ///< inner rows, plus unmatched left rows with empty right fields
+   JOIN_SEMI,        ///< left rows with at least one matching right row
+   JOIN_ANTI         ///< left rows without a matching right row
+} JOIN_TYPE;
+
+/**
+ * @brief Matching right rows of each left row, collected in two
+ *        passes: the first counts the matches of each left row, the
+ *        second saves them.
+ */
+typedef struct join_matches {
+   size_t  *offsets;   ///< first match of each left row, and the match
+                       ///< count after the last left row
+   size_t  *cursor;    ///< next match to save for each left row, or NULL
+                       ///< while counting
+   int32_t *rights;    ///< right row of each match, grouped by left row
+} JMATCH;
+
+/**
+ * @brief Count or save a match of a left and right row
+ */
+static inline void join_add_match(JMATCH *matches, int left, int right)
+{
+   if (matches->cursor)
+      matches->rights[matches->cursor[left]++] = right;
+   else
+      ++matches->offsets[left + 1];
+}
+
+/**
+ * @brief True if a handle was sorted (`sort -k`) in ascending string
+ *        order of @p column, so it can be merged
+ */
+static bool join_is_sorted_by(const AHEAD *head, int column)
+{
+   const SORDER *order = head->order;
+   if (order == NULL || order->key_column != SORDER_TABLE_ROWS)
+      return False;
+
+   const SCOL *col = &order->spec->columns[0];
+   return col->column == column && !col->numeric && !col->reverse && !col->collate;
+}
+
+/**
+ * @brief Find matches by merging two handles sorted by their join columns
+ */
+static void join_merge(JMATCH *matches,
+                       const AHEAD *left, int lcol,
+                       const AHEAD *right, int rcol)
+{
+   int l = 0, r = 0;
+   while (l < left->row_count && r < right->row_count)
+   {
+      const char *value = get_row_field(left->rows[l], lcol);
+      int comp = strcmp(value, get_row_field(right->rows[r], rcol));
+      if (comp < 0)
+         ++l;
+      else if (comp > 0)
+         ++r;
+      else
+      {
+         // Every left row of the run matches every right row of the run
+         int run_end = r + 1;
+         while (run_end < right->row_count
+                && 0 == strcmp(value, get_row_field(right->rows[run_end], rcol)))
+            ++run_end;
+
+         for (; l < left->row_count && 0 == strcmp(value, get_row_field(left->rows[l], lcol)); ++l)
+            for (int i = r; i < run_end; ++i)
+               join_add_match(matches, l, i);
+
+         r = run_end;
+      }
+   }
+}
+
+/**
+ * @brief Find matches by looking up values of one handle in a hash
+ *        index of the other
+ * @param "matches"     [in,out] matches to count or save
+ * @param "probe"       [in]     handle whose rows are looked up
+ * @param "probe_col"   [in]     join column of @p probe
+ * @param "hashed"      [in]     handle with a hash index of its join column
+ * @param "probe_left"  [in]     True if @p probe is the left handle
+ */
+static void join_hash(JMATCH *matches,
+                      const AHEAD *probe, int probe_col,
+                      const AHEAD *hashed,
+                      bool probe_left)
+{
+   for (int p=0; p < probe->row_count; ++p)
+   {
+      const char *value = get_row_field(probe->rows[p], probe_col);
+      for (int h = hash_index_find(hashed, value); h >= 0; h = hash_index_next(hashed, h))
+      {
+         if (probe_left)
+            join_add_match(matches, p, h);
+         else
+            join_add_match(matches, h, p);
+      }
+   }
+}
+
+/**
+ * @brief Copy the fields of a row to the end of a table array
+ */
+static void join_copy_row(ARRAY *array, arrayind_t *index, ARRAY_ELEMENT *row, int row_size)
+{
+   for (int i=0; i < row_size; ++i, row = row->next)
+      array_insert(array, (*index)++, row->value ? row->value : "");
+}
+
+/**
+ * @brief Parse the `-t` join type
+ * @return True if @p str names a join type
+ */
+static bool join_parse_type(JOIN_TYPE *type, const char *str)
+{
+   static const char *names[] = { "inner", "left", "semi", "anti" };
+
+   for (int i=0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+   {
+      if (0 == strcmp(str, names[i]))
+      {
+         *type = (JOIN_TYPE)i;
+         return True;
+      }
+   }
+
+   return False;
+}
+
+/**
+ * @brief Validate a join column argument
+ * @return EXECUTION_SUCCESS or EX_USAGE
+ */
+static int join_get_column(int *column, const char *str, const AHEAD *head, const char *arg_name)
+{
+   if (str == NULL)
+   {
+      ate_register_missing_argument(arg_name, "join");
+      return EX_USAGE;
+   }
+
+   if (!get_int_from_string(column, str))
+   {
+      ate_register_not_an_int(str, "join");
+      return EX_USAGE;
+   }
+
+   if (*column < 0 || *column >= head->row_size)
+   {
+      ate_register_error("join column %d is out of range for row size %d in 'join'",
+                         *column, head->row_size);
+      return EX_USAGE;
+   }
+
+   return EXECUTION_SUCCESS;
+}
+
+/**
+ * @brief Make a hash handle of a handle's rows for a join
+ * @return new head, to be released with `xfree`
+ */
+static AHEAD *join_make_hash_head(const AHEAD *head, int column)
+{
+   int row_count = head->row_count;
+   AHEAD *hash_head = (AHEAD*)xmalloc(ate_calculate_head_size(row_count)
+                                      + hash_index_size(row_count));
+   if (!ate_initialize_head(hash_head, head->array, head->row_size))
+   {
+      xfree(hash_head);
+      return NULL;
+   }
+
+   memcpy(hash_head->rows, head->rows, row_count * sizeof(ARRAY_ELEMENT*));
+   hash_head->row_count = row_count;
+   hash_index_build(hash_head, column);
+   return hash_head;
+}
+
+/**
+ * @brief Find the matching right rows of every left row
+ *
+ * Two handles sorted by their join columns are merged.  Otherwise,
+ * the values of one handle are looked up in a hash index of the
+ * other: the existing index of a `make_hash` handle of the join
+ * column, or a new index of the smaller handle.
+ *
+ * @param "matches"     [out] matches, grouped by left row in left row
+ *                            order, and in right row order for each
+ *                            left row
+ * @param "left"        [in]  left handle
+ * @param "lcol"        [in]  join column of the left handle
+ * @param "right"       [in]  right handle
+ * @param "rcol"        [in]  join column of the right handle
+ * @param "save_rights" [in]  False if only the numbers of matches are needed
+ * @return True if successful
+ */
+static bool join_find_matches(JMATCH *matches,
+                              const AHEAD *left, int lcol,
+                              const AHEAD *right, int rcol,
+                              bool save_rights)
+{
+   bool merge = join_is_sorted_by(left, lcol) && join_is_sorted_by(right, rcol);
+
+   const AHEAD *hashed = NULL;
+   AHEAD *new_hash_head = NULL;
+   bool probe_left = True;
+
+   if (!merge)
+   {
+      if (right->hash && right->hash->column == rcol)
+         hashed = right;
+      else if (left->hash && left->hash->column == lcol)
+      {
+         hashed = left;
+         probe_left = False;
+      }
+      else
+      {
+         probe_left = right->row_count <= left->row_count;
+         new_hash_head = probe_left
+            ? join_make_hash_head(right, rcol)
+            : join_make_hash_head(left, lcol);
+         if (new_hash_head == NULL)
+            return False;
+         hashed = new_hash_head;
+      }
+   }
+
+   matches->offsets = (size_t*)xmalloc((left->row_count + 1) * sizeof(size_t));
+   memset(matches->offsets, 0, (left->row_count + 1) * sizeof(size_t));
+   matches->cursor = NULL;
+   matches->rights = NULL;
+
+   for (int pass=0; pass < (save_rights ? 2 : 1); ++pass)
+   {
+      if (merge)
+         join_merge(matches, left, lcol, right, rcol);
+      else if (probe_left)
+         join_hash(matches, left, lcol, hashed, True);
+      else
+         join_hash(matches, right, rcol, hashed, False);
+
+      if (pass == 0)
+      {
+         // Turn the counts into offsets
+         for (int l=0; l < left->row_count; ++l)
+            matches->offsets[l+1] += matches->offsets[l];
+
+         if (save_rights)
+         {
+            size_t total = matches->offsets[left->row_count];
+            matches->rights = (int32_t*)xmalloc((total ? total : 1) * sizeof(int32_t));
+            matches->cursor = (size_t*)xmalloc((left->row_count + 1) * sizeof(size_t));
+            memcpy(matches->cursor, matches->offsets, (left->row_count + 1) * sizeof(size_t));
+         }
+      }
+   }
+
+   if (new_hash_head)
+      xfree(new_hash_head);
+
+   return True;
+}
+
+/**
+ * @brief Join the rows of two handles into a new table
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_join(ARG_LIST *alist)
+{
+   const char *left_handle_name = NULL;
+   const char *left_column_string = NULL;
+   const char *right_handle_name = NULL;
+   const char *right_column_string = NULL;
+   const char *new_handle_name = NULL;
+   const char *array_name = NULL;
+   const char *type_string = NULL;
+
+   ARG_TARGET join_targets[] = {
+      { "left_handle_name",  AL_ARG, &left_handle_name},
+      { "left_column",       AL_ARG, &left_column_string},
+      { "right_handle_name", AL_ARG, &right_handle_name},
+      { "right_column",      AL_ARG, &right_column_string},
+      { "new_handle_name",   AL_ARG, &new_handle_name},
+      { "a",                 AL_OPT, &array_name},
+      { "t",                 AL_OPT, &type_string},
+      { NULL }
+   };
+
+   int retval;
+
+   // Checked on early exit, must be initialized
+   JMATCH matches = { NULL, NULL, NULL };
+
+   if ((retval = process_word_list_args(join_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *left_var, *right_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&left_var, left_handle_name, "join")))
+      goto early_exit;
+
+   AHEAD *left = ahead_cell(left_var);
+   int lcol;
+   if ((retval = join_get_column(&lcol, left_column_string, left, "left_column")))
+      goto early_exit;
+
+   if ((retval = get_table_handle_var_by_name_or_fail(&right_var, right_handle_name, "join")))
+      goto early_exit;
+
+   AHEAD *right = ahead_cell(right_var);
+   int rcol;
+   if ((retval = join_get_column(&rcol, right_column_string, right, "right_column")))
+      goto early_exit;
+
+   retval = EX_USAGE;
+
+   if (new_handle_name == NULL)
+   {
+      ate_register_missing_argument("new_handle_name", "join");
+      goto early_exit;
+   }
+
+   JOIN_TYPE type = JOIN_INNER;
+   if (type_string && !join_parse_type(&type, type_string))
+   {
+      ate_register_error("unknown join type '%s' (inner, left, semi or anti) in 'join'",
+                         type_string);
+      goto early_exit;
+   }
+
+   // The joined rows are copied from the source tables, which must
+   // not be replaced by the new table
+   SHELL_VAR *array_var = NULL;
+   if (array_name)
+   {
+      SHELL_VAR *existing = find_variable(array_name);
+      if (existing && (existing == left->array || existing == right->array))
+      {
+         ate_register_error("array '%s' of a joined table cannot receive the joined rows",
+                            array_name);
+         goto early_exit;
+      }
+
+      if ((retval = create_array_var_by_given_or_default_name(&array_var,
+                                                              array_name,
+                                                              NULL,
+                                                              "join")))
+         goto early_exit;
+   }
+   else if ((retval = create_array_var_by_stem(&array_var, "ATE_HOSTED_ARRAY_", "join")))
+      goto early_exit;
+
+   retval = EXECUTION_FAILURE;
+
+   bool pairs = type == JOIN_INNER || type == JOIN_LEFT;
+   if (!join_find_matches(&matches, left, lcol, right, rcol, pairs))
+   {
+      ate_register_unexpected_error("indexing the join column");
+      goto early_exit;
+   }
+
+   ARRAY *array = array_cell(array_var);
+   arrayind_t index = 0;
+
+   for (int l=0; l < left->row_count; ++l)
+   {
+      size_t first = matches.offsets[l];
+      size_t end = matches.offsets[l+1];
+
+      if (pairs)
+      {
+         for (size_t m = first; m < end; ++m)
+         {
+            join_copy_row(array, &index, left->rows[l], left->row_size);
+            join_copy_row(array, &index, right->rows[matches.rights[m]], right->row_size);
+         }
+
+         if (type == JOIN_LEFT && first == end)
+         {
+            join_copy_row(array, &index, left->rows[l], left->row_size);
+            for (int i=0; i < right->row_size; ++i)
+               array_insert(array, index++, "");
+         }
+      }
+      else if ((first < end) == (type == JOIN_SEMI))
+         join_copy_row(array, &index, left->rows[l], left->row_size);
+   }
+
+   int row_size = left->row_size + (pairs ? right->row_size : 0);
+
+   SHELL_VAR *new_handle_var = NULL;
+   if (ate_create_handle(&new_handle_var, new_handle_name, array_var, row_size))
+      retval = EXECUTION_SUCCESS;
+   else
+      ate_register_error("failed to create handle in action 'join'");
+
+  early_exit:
+   if (matches.offsets)
+      xfree(matches.offsets);
+   if (matches.cursor)
+      xfree(matches.cursor);
+   if (matches.rights)
+      xfree(matches.rights);
+
+   return retval;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file pwla_make_hash.c
+ * @brief `make_hash` action implementation
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_hash.h"
+
+/**
+ * @brief Make a handle with a hash index of a column for exact-match
+ *        lookups with `seek_hash`.
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * The new handle has the same rows, in the same order, as the source
+ * handle, so a row index found with `seek_hash` can be used with
+ * either handle.
+ *
+ * see man ate(1)
+ */
+int pwla_make_hash(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *new_handle_name = NULL;
+   const char *column_index_string = NULL;
+
+   ARG_TARGET make_hash_targets[] = {
+      { "handle_name",     AL_ARG, &handle_name},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { "c",               AL_OPT, &column_index_string},
+      { NULL }
+   };
+
+   int retval;
+
+   if ((retval = process_word_list_args(make_hash_targets, alist, 0)))
+       goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "make_hash")))
+      goto early_exit;
+
+   retval = EX_USAGE;
+
+   if (new_handle_name == NULL)
+   {
+      ate_register_missing_argument("new_handle_name", "make_hash");
+      goto early_exit;
+   }
+
+   AHEAD *ahead = ahead_cell(handle_var);
+
+   int column_index = 0;
+   if (column_index_string)
+   {
+      if (get_int_from_string(&column_index, column_index_string))
+      {
+         if (column_index < 0 || column_index >= ahead->row_size)
+         {
+            ate_register_error("requested column %d is out of range in make_hash", column_index);
+            goto early_exit;
+         }
+      }
+      else
+      {
+         ate_register_not_an_int(column_index_string, "make_hash");
+         goto early_exit;
+      }
+   }
+
+   retval = EXECUTION_FAILURE;
+
+   int row_count = ahead->row_count;
+   AHEAD *new_head = (AHEAD*)xmalloc(ate_calculate_head_size(row_count)
+                                     + hash_index_size(row_count));
+   if (ate_initialize_head(new_head, ahead->array, ahead->row_size))
+   {
+      memcpy(new_head->rows, ahead->rows, row_count * sizeof(ARRAY_ELEMENT*));
+      new_head->row_count = row_count;
+      hash_index_build(new_head, column_index);
+
+      SHELL_VAR *new_handle_var = NULL;
+      if (ate_create_handle_with_head(&new_handle_var, new_handle_name, new_head))
+         retval = EXECUTION_SUCCESS;
+      else
+         xfree(new_head);
+   }
+   else
+   {
+      ate_register_unexpected_error("initializing the hash handle");
+      xfree(new_head);
+   }
+
+  early_exit:
+   return retval;
+}
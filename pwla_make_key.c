@@ -5,6 +5,7 @@
 #include "ate_handle.h"
 #include "ate_utilities.h"
 #include "ate_errors.h"
+#include "ate_sort.h"
 
 #include "word_list_stack.h"
 
@@ -21,14 +22,349 @@ typedef struct pwla_comparison_struct {
    comp_func func;
 } pwla_comp;
 
-int pwla_make_key_qsort_callback(const void *left, const void *right, void *sorter)
+int pwla_make_key_sort_callback(const void *left, const void *right, void *sorter)
 {
    pwla_comp *psf_sorter = (pwla_comp*)sorter;
-   ARRAY_ELEMENT *el_left = *(ARRAY_ELEMENT**)left;
-   ARRAY_ELEMENT *el_right = *(ARRAY_ELEMENT**)right;
+   const ARRAY_ELEMENT *el_left = (const ARRAY_ELEMENT*)left;
+   const ARRAY_ELEMENT *el_right = (const ARRAY_ELEMENT*)right;
    return (*psf_sorter->func)(el_left->value, el_right->value);
 }
 
+/**
+ * @brief Sort integer key rows with a radix sort
+ *
+ * Each key string is converted only once, into a record that carries
+ * the row pointer, instead of being converted for every comparison.
+ * Keys that are not integers are sorted as 0.
+ *
+ * @param "head"       key table head whose rows are to be sorted
+ * @param "descending" True for a reverse (-r) sort
+ */
+static void pwla_make_key_radix_sort(AHEAD *head, bool descending)
+{
+   int row_count = head->row_count;
+   IKREC *records = (IKREC*)xmalloc((row_count ? row_count : 1) * sizeof(IKREC));
+
+   for (int i=0; i < row_count; ++i)
+   {
+      long key = 0;
+      get_long_from_string(&key, head->rows[i]->value);
+      records[i].key = key;
+      records[i].row = head->rows[i];
+   }
+
+   ate_radix_sort(records, row_count, descending);
+
+   for (int i=0; i < row_count; ++i)
+      head->rows[i] = records[i].row;
+
+   xfree(records);
+}
+
+/**
+ * @brief Sort key rows by the LC_COLLATE locale and record the order
+ *
+ * The key values are transformed with `strxfrm` once each, sorted
+ * by byte comparison, then saved with the head's order record for
+ * `seek_key` to search.
+ *
+ * @param "head"       [in,out] key table head whose rows are to be sorted,
+ *                              which may be reallocated
+ * @param "key_spec"   [in]     single-column collated specification
+ * @param "source"     [in]     handle from which the keys were made
+ * @param "key_column" [in]     column of the keys, or SORDER_FUNCTION_KEY
+ * @param "extras"     [in]     search aids to add (-E, -B)
+ * @return True if successful
+ */
+static bool pwla_make_key_collated_sort(AHEAD **head,
+                                        const SSPEC *key_spec,
+                                        const AHEAD *source,
+                                        int key_column,
+                                        const SOEXTRAS *extras)
+{
+   bool result = False;
+   int row_count = (*head)->row_count;
+
+   SREC *records = NULL;
+   if (!sort_records_create(&records, *head, key_spec))
+      return False;
+
+   SREC **order = (SREC**)xmalloc((row_count ? row_count : 1) * sizeof(SREC*));
+   for (int i=0; i < row_count; ++i)
+      order[i] = &records[i];
+
+   if (ate_stable_sort((void**)order, row_count, sort_records_sort_callback, (void*)key_spec))
+   {
+      for (int i=0; i < row_count; ++i)
+         (*head)->rows[i] = order[i]->row;
+
+      result = sort_order_append(head,
+                                 source->array,
+                                 source->row_count,
+                                 key_column,
+                                 key_spec,
+                                 order,
+                                 extras);
+   }
+
+   xfree(order);
+   xfree(records);
+   return result;
+}
+
+/**
+ * @brief Make a key table of several columns, compared column by column
+ *
+ * Each key row holds the values of the key columns, in the order of
+ * @p source_spec, followed by the index of the source row.  The rows
+ * are sorted with the types and directions of @p source_spec.
+ *
+ * @param "new_handle_var" [in,out] handle variable to receive the key
+ * @param "source"         [in]     handle of the table to key
+ * @param "source_spec"    [in]     source columns of the key, in order
+ * @param "numeric"        [in]     True to compare every column as integers (-i)
+ * @param "reverse"        [in]     True to reverse every column (-r)
+ * @param "single_only"    [in]     True if an option for single-column keys
+ *                                  (-l, -B, -E or -n) was used
+ * @param "stem"           [in]     stem of the name of the key's array
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int pwla_make_key_composite(SHELL_VAR *new_handle_var,
+                                   const AHEAD *source,
+                                   const SSPEC *source_spec,
+                                   bool numeric,
+                                   bool reverse,
+                                   bool single_only,
+                                   const char *stem)
+{
+   int key_count = source_spec->count;
+
+   // Collated keys, Bloom filters and the Eytzinger layout are
+   // searched by one string
+   bool collate = False;
+   for (int i=0; i < key_count; ++i)
+      collate = collate || source_spec->columns[i].collate;
+
+   if (collate || single_only)
+   {
+      ate_register_error("options -l, -B, -E and -n cannot be used with a composite key in 'make_key'");
+      return EX_USAGE;
+   }
+
+   SHELL_VAR *handle_array = NULL;
+   int retval;
+   if ((retval = create_array_var_by_stem(&handle_array, stem, "make_key")))
+      return retval;
+
+   ARRAY *target_array = array_cell(handle_array);
+   arrayind_t array_index = 0;
+
+   // For use with snprintf to stringify numbers for array elements
+   char number_buffer[32];
+
+   for (int row_index=0; row_index < source->row_count; ++row_index)
+   {
+      for (int i=0; i < key_count; ++i)
+      {
+         ARRAY_ELEMENT *col = source->rows[row_index];
+         for (int field_index=0; field_index < source_spec->columns[i].column; ++field_index)
+            col = col->next;
+
+         array_insert(target_array, array_index++, col->value);
+      }
+
+      snprintf(number_buffer, sizeof(number_buffer), "%d", row_index);
+      array_insert(target_array, array_index++, number_buffer);
+   }
+
+   AHEAD *newhead = NULL;
+   if (!ate_create_indexed_head(&newhead, handle_array, key_count + 1))
+   {
+      ate_register_error("unexpected failure indexing a new handle in 'make_key'");
+      return EXECUTION_FAILURE;
+   }
+
+   // Key column i holds the values of the i-th source column
+   size_t spec_size = sizeof(SSPEC) + key_count * sizeof(SCOL);
+   SSPEC *key_spec = (SSPEC*)alloca(spec_size);
+   memcpy(key_spec, source_spec, spec_size);
+   for (int i=0; i < key_count; ++i)
+   {
+      key_spec->columns[i].column = i;
+      key_spec->columns[i].source = source_spec->columns[i].column;
+      key_spec->columns[i].numeric = key_spec->columns[i].numeric || numeric;
+      key_spec->columns[i].reverse = key_spec->columns[i].reverse || reverse;
+   }
+
+   retval = EXECUTION_FAILURE;
+
+   SREC *records = NULL;
+   SREC **order = NULL;
+   if (!sort_records_create(&records, newhead, key_spec))
+   {
+      ate_register_unexpected_error("preparing keys for sorting");
+      goto abandon_head;
+   }
+
+   order = (SREC**)xmalloc((newhead->row_count ? newhead->row_count : 1) * sizeof(SREC*));
+   for (int i=0; i < newhead->row_count; ++i)
+      order[i] = &records[i];
+
+   if (!ate_stable_sort((void**)order, newhead->row_count, sort_records_sort_callback, key_spec))
+   {
+      ate_register_unexpected_error("sorting keys");
+      goto abandon_head;
+   }
+
+   for (int i=0; i < newhead->row_count; ++i)
+      newhead->rows[i] = order[i]->row;
+
+   // Remember the source columns so new rows can be merged (merge_new_rows)
+   if (!sort_order_append(&newhead,
+                          source->array,
+                          source->row_count,
+                          key_spec->columns[0].source,
+                          key_spec,
+                          NULL,
+                          NULL))
+   {
+      ate_register_unexpected_error("recording the key order");
+      goto abandon_head;
+   }
+
+   ate_dispose_variable_value(new_handle_var);
+   new_handle_var->value = (char*)newhead;
+   new_handle_var->attributes = att_special;
+   newhead = NULL;
+
+   retval = EXECUTION_SUCCESS;
+
+  abandon_head:
+   if (order)
+      xfree(order);
+   if (records)
+      xfree(records);
+   if (newhead)
+      xfree(newhead);
+
+   return retval;
+}
+
+/**
+ * @brief Make a native key, whose rows point to the key fields of the
+ *        source rows, with the source row indexes kept in the head
+ *
+ * No key values or row index strings are copied to a new array.  The
+ * key rows read as a key value and a row index, like the rows of an
+ * ordinary key, through `get_row` and `walk_rows`.  Like any handle,
+ * the key must be remade if the source table is reindexed.
+ *
+ * @param "new_handle_var" [in,out] handle variable to receive the key
+ * @param "source"         [in]     handle of the table to key
+ * @param "column_index"   [in]     source column of the key values
+ * @param "numeric"        [in]     True to compare keys as integers (-i)
+ * @param "reverse"        [in]     True to sort in descending order (-r)
+ * @param "collate"        [in]     True to sort by LC_COLLATE (-l)
+ * @param "extras"         [in]     search aids to add (-E, -B)
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int pwla_make_key_native(SHELL_VAR *new_handle_var,
+                                const AHEAD *source,
+                                int column_index,
+                                bool numeric,
+                                bool reverse,
+                                bool collate,
+                                const SOEXTRAS *extras)
+{
+   int retval = EXECUTION_FAILURE;
+   int row_count = source->row_count;
+
+   SREC *records = NULL;
+   SREC **order = NULL;
+
+   AHEAD *newhead = (AHEAD*)xmalloc(ate_calculate_native_key_size(row_count));
+   if (!ate_initialize_head(newhead, source->array, 0))
+   {
+      ate_register_unexpected_error("initializing the key handle");
+      goto abandon_head;
+   }
+
+   // Each row reads as the key value and its row index
+   newhead->row_size = 2;
+   newhead->row_count = row_count;
+   newhead->key_rows = (int32_t*)&newhead->rows[row_count];
+
+   for (int row_index=0; row_index < row_count; ++row_index)
+   {
+      ARRAY_ELEMENT *col = source->rows[row_index];
+      for (int field_index=0; field_index < column_index; ++field_index)
+         col = col->next;
+
+      newhead->rows[row_index] = col;
+   }
+
+   SSPEC *key_spec = (SSPEC*)alloca(sizeof(SSPEC) + sizeof(SCOL));
+   key_spec->count = 1;
+   key_spec->columns[0].column = 0;
+   key_spec->columns[0].source = column_index;
+   key_spec->columns[0].numeric = numeric;
+   key_spec->columns[0].reverse = reverse;
+   key_spec->columns[0].collate = collate;
+
+   // Records are made in source row order, so a record's position
+   // is the source row index of its key.
+   if (!sort_records_create(&records, newhead, key_spec))
+   {
+      ate_register_unexpected_error("preparing keys for sorting");
+      goto abandon_head;
+   }
+
+   order = (SREC**)xmalloc((row_count ? row_count : 1) * sizeof(SREC*));
+   for (int i=0; i < row_count; ++i)
+      order[i] = &records[i];
+
+   if (!ate_stable_sort((void**)order, row_count, sort_records_sort_callback, key_spec))
+   {
+      ate_register_unexpected_error("sorting keys");
+      goto abandon_head;
+   }
+
+   for (int i=0; i < row_count; ++i)
+   {
+      newhead->rows[i] = order[i]->row;
+      newhead->key_rows[i] = (int32_t)(order[i] - records);
+   }
+
+   if (!sort_order_append(&newhead,
+                          source->array,
+                          row_count,
+                          column_index,
+                          key_spec,
+                          collate ? order : NULL,
+                          extras))
+   {
+      ate_register_unexpected_error("recording the key order");
+      goto abandon_head;
+   }
+
+   ate_dispose_variable_value(new_handle_var);
+   new_handle_var->value = (char*)newhead;
+   new_handle_var->attributes = att_special;
+   newhead = NULL;
+
+   retval = EXECUTION_SUCCESS;
+
+  abandon_head:
+   if (order)
+      xfree(order);
+   if (records)
+      xfree(records);
+   if (newhead)
+      xfree(newhead);
+
+   return retval;
+}
+
 /**
  * @brief Make an index with which one can submit a name and get a
  *        row index in return.
@@ -45,6 +381,11 @@ int pwla_make_key(ARG_LIST *alist)
    const char *function_name = NULL;
    const char *int_sort_flag = NULL;
    const char *reverse_sort_flag = NULL;
+   const char *collate_flag = NULL;
+   const char *eytzinger_flag = NULL;
+   const char *native_flag = NULL;
+   const char *bloom_bits_string = NULL;
+   const char *projection_str = NULL;
 
    ARG_TARGET walk_rows_targets[] = {
       { "handle_name",     AL_ARG,  &handle_name},
@@ -53,18 +394,30 @@ int pwla_make_key(ARG_LIST *alist)
       { "f",               AL_OPT,  &function_name},
       { "i",               AL_FLAG, &int_sort_flag},
       { "r",               AL_FLAG, &reverse_sort_flag},
+      { "l",               AL_FLAG, &collate_flag},
+      { "E",               AL_FLAG, &eytzinger_flag},
+      { "n",               AL_FLAG, &native_flag},
+      { "B",               AL_OPT,  &bloom_bits_string},
+      { "p",               AL_OPT,  &projection_str},
      { NULL }
    };
 
    int retval;
 
+   // Checked on early exit, must be initialized
+   PREPFUNC callback;
+   memset(&callback, 0, sizeof(callback));
+   RPROJ *projection = NULL;
+   RBUFS row_buffers;
+   memset(&row_buffers, 0, sizeof(row_buffers));
+
    if ((retval = process_word_list_args(walk_rows_targets, alist, 0)))
        goto early_exit;
 
    SHELL_VAR *handle_var;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "make_key")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "make_key")))
       goto early_exit;
 
    AHEAD *ahead = ahead_cell(handle_var);
@@ -83,6 +436,144 @@ int pwla_make_key(ARG_LIST *alist)
                                                   "make_key"))))
       goto early_exit;
 
+   // A projection (-p) limits the columns copied for the -f function
+   if (projection_str)
+   {
+      if (!function_var)
+      {
+         ate_register_error("option -p requires option -f in 'make_key'");
+         retval = EX_USAGE;
+         goto early_exit;
+      }
+
+      if ((retval = row_projection_parse(&projection, projection_str, ahead->row_size, "make_key")))
+         goto early_exit;
+   }
+
+   static const char *MI_STEM = "PWLA_MAKE_KEY_";
+
+   // A column list (-c 1,3n) makes a composite key, each column with
+   // its own type, like a sort specification.
+   int column_index = 0;
+   if (!function_var
+       && column_index_string
+       && column_index_string[strspn(column_index_string, "0123456789")])
+   {
+      SSPEC *source_spec = NULL;
+      if ((retval = sort_spec_parse(&source_spec, column_index_string, ahead->row_size, "make_key")))
+         goto early_exit;
+
+      if (source_spec->count > 1)
+      {
+         retval = pwla_make_key_composite(new_handle_var,
+                                          ahead,
+                                          source_spec,
+                                          int_sort_flag != NULL,
+                                          reverse_sort_flag != NULL,
+                                          collate_flag || eytzinger_flag || native_flag
+                                          || bloom_bits_string,
+                                          MI_STEM);
+         xfree(source_spec);
+         goto early_exit;
+      }
+
+      // A single column with modifiers makes an ordinary key
+      const SCOL *col = &source_spec->columns[0];
+      column_index = col->column;
+      if (col->numeric)
+         int_sort_flag = column_index_string;
+      if (col->reverse)
+         reverse_sort_flag = column_index_string;
+      if (col->collate)
+         collate_flag = column_index_string;
+
+      xfree(source_spec);
+      column_index_string = NULL;
+   }
+   else if (!function_var && column_index_string)
+   {
+      retval = EX_USAGE;
+
+      if (get_int_from_string(&column_index, column_index_string))
+      {
+         if (column_index < 0 || column_index >= ahead->row_size)
+         {
+            ate_register_error("requested column %d is out of range in make_key", column_index);
+            goto early_exit;
+         }
+      }
+      else
+      {
+         ate_register_error("failed to convert '%s' to an integer in make_key", column_index_string);
+         goto early_exit;
+      }
+
+      retval = EXECUTION_SUCCESS;
+   }
+
+   if (int_sort_flag && collate_flag)
+   {
+      ate_register_error("options -i and -l cannot be combined in 'make_key'");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   // The Eytzinger layout is searched by string comparisons in ascending order
+   if (eytzinger_flag && (int_sort_flag || reverse_sort_flag))
+   {
+      ate_register_error("option -E cannot be combined with -i or -r in 'make_key'");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   // A Bloom filter (-B) lets seek_key reject most absent string values
+   SOEXTRAS extras = { eytzinger_flag != NULL, 0 };
+   if (bloom_bits_string)
+   {
+      retval = EX_USAGE;
+
+      if (!get_int_from_string(&extras.bloom_bits, bloom_bits_string))
+      {
+         ate_register_not_an_int(bloom_bits_string, "make_key");
+         goto early_exit;
+      }
+
+      if (extras.bloom_bits < 1 || extras.bloom_bits > 64)
+      {
+         ate_register_error("bits per key %d is out of range (1 to 64) in make_key",
+                            extras.bloom_bits);
+         goto early_exit;
+      }
+
+      if (int_sort_flag)
+      {
+         ate_register_error("options -i and -B cannot be combined in 'make_key'");
+         goto early_exit;
+      }
+
+      retval = EXECUTION_SUCCESS;
+   }
+
+   // A native key (-n) refers to the key fields of the source rows
+   // instead of copying them to a new array.
+   if (native_flag)
+   {
+      if (function_var)
+      {
+         ate_register_error("options -f and -n cannot be combined in 'make_key'");
+         retval = EX_USAGE;
+      }
+      else
+         retval = pwla_make_key_native(new_handle_var,
+                                       ahead,
+                                       column_index,
+                                       int_sort_flag != NULL,
+                                       reverse_sort_flag != NULL,
+                                       collate_flag != NULL,
+                                       &extras);
+      goto early_exit;
+   }
+
    // Set sorting function to string or integer sort,
    // according to presence or absence of the -i flag.
    int (*sort_func)(const char*, const char*) = strcmp;
@@ -100,8 +591,6 @@ int pwla_make_key(ARG_LIST *alist)
    // We'll defer any allocation functions until we know the
    // user inputs are acceptable
 
-   static const char *MI_STEM = "PWLA_MAKE_KEY_";
-
    // You can't cast a void* to a function pointer, so
    // we gotta put the function pointer into a struct
    pwla_comp comp_struct = { sort_func };
@@ -142,6 +631,7 @@ int pwla_make_key(ARG_LIST *alist)
          WL_APPEND(cb_tail, extra->value);
          extra = extra->next;
       }
+      prepare_shell_function(&callback, function_var, cb_head);
 
       // Prepare variables to collect results of callback function
       ARRAY *target_array = array_cell(handle_array);
@@ -152,11 +642,16 @@ int pwla_make_key(ARG_LIST *alist)
       while (ae_source < ae_end)
       {
          // Fill the target row with current row contents
-         if ((retval = update_row_array(cb_row, *ae_source, ahead->row_size)))
+         if (projection)
+            retval = update_projected_row_array(cb_row, *ae_source, projection, &row_buffers);
+         else
+            retval = update_row_array(cb_row, *ae_source, ahead->row_size, &row_buffers);
+
+         if (retval)
             goto early_exit;
 
          // Ask the caller how to save the row
-         invoke_shell_function_word_list(function_var, cb_head);
+         invoke_prepared_function(&callback);
 
          // Write the user's info to the new array:
          snprintf(number_buffer, sizeof(number_buffer), "%d", row_index);
@@ -171,26 +666,6 @@ int pwla_make_key(ARG_LIST *alist)
    // requested a column index, we'll validate the value before continuing
    else
    {
-      retval = EX_USAGE;
-
-      int column_index = 0;
-      if (column_index_string)
-      {
-         if (get_int_from_string(&column_index, column_index_string))
-         {
-            if (column_index < 0 || column_index >= ahead->row_size)
-            {
-               ate_register_error("requested column %d is out of range in make_key", column_index);
-               goto early_exit;
-            }
-         }
-         else
-         {
-            ate_register_error("failed to convert '%s' to an integer in make_key", column_index_string);
-            goto early_exit;
-         }
-      }
-
       if ((retval = create_array_var_by_stem(&handle_array, MI_STEM, "make_key")))
          goto early_exit;
 
@@ -226,17 +701,58 @@ int pwla_make_key(ARG_LIST *alist)
    AHEAD *newhead = NULL;
    if (ate_create_indexed_head(&newhead, handle_array, 2))
    {
-      qsort_r(newhead->rows,
-              newhead->row_count,
-              sizeof(ARRAY_ELEMENT*),
-              pwla_make_key_qsort_callback,
-              (void*)&comp_struct);
+      SSPEC *key_spec = (SSPEC*)alloca(sizeof(SSPEC) + sizeof(SCOL));
+      key_spec->count = 1;
+      key_spec->columns[0].column = 0;
+      key_spec->columns[0].numeric = int_sort_flag != NULL;
+      key_spec->columns[0].reverse = reverse_sort_flag != NULL;
+      key_spec->columns[0].collate = collate_flag != NULL;
+
+      int key_column = function_var ? SORDER_FUNCTION_KEY : column_index;
+      key_spec->columns[0].source = key_column;
+
+      // Remember how the keys were made so that keys for rows
+      // added later can be merged (merge_new_rows)
+      bool recorded;
+      if (collate_flag)
+         recorded = pwla_make_key_collated_sort(&newhead,
+                                                key_spec,
+                                                ahead,
+                                                key_column,
+                                                &extras);
+      else
+      {
+         if (int_sort_flag)
+            pwla_make_key_radix_sort(newhead, reverse_sort_flag != NULL);
+         else
+            ate_stable_sort((void**)newhead->rows,
+                            newhead->row_count,
+                            pwla_make_key_sort_callback,
+                            (void*)&comp_struct);
+
+         recorded = sort_order_append(&newhead,
+                                      ahead->array,
+                                      ahead->row_count,
+                                      key_column,
+                                      key_spec,
+                                      NULL,
+                                      &extras);
+      }
 
-      ate_dispose_variable_value(new_handle_var);
-      new_handle_var->value = (char*)newhead;
-      new_handle_var->attributes = att_special;
+      if (recorded)
+      {
+         ate_dispose_variable_value(new_handle_var);
+         new_handle_var->value = (char*)newhead;
+         new_handle_var->attributes = att_special;
 
-      retval = EXECUTION_SUCCESS;
+         retval = EXECUTION_SUCCESS;
+      }
+      else
+      {
+         xfree(newhead);
+         ate_register_unexpected_error("recording the key order");
+         retval = EXECUTION_FAILURE;
+      }
    }
    else
    {
@@ -245,6 +761,10 @@ int pwla_make_key(ARG_LIST *alist)
    }
 
   early_exit:
+   row_buffers_release(&row_buffers);
+   release_prepared_function(&callback);
+   if (projection)
+      xfree(projection);
    reverse_base_func = NULL;
    return retval;
 }
@@ -0,0 +1,90 @@
+/**
+ * @file pwla_match_glob.c
+ * @brief `match_glob` action implementation
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_glob.h"
+
+/**
+ * @brief Find the first row whose glob pattern matches a string
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * The index of the first matching row is saved to the value
+ * variable.  As with `seek_hash`, the outcome variable reports 1 for
+ * a match or 0 for no match.
+ *
+ * see man ate(1)
+ */
+int pwla_match_glob(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *search_value = NULL;
+   const char *value_name = NULL;
+   const char *outcome_name = NULL;
+
+   ARG_TARGET match_glob_targets[] = {
+      { "handle_name",  AL_ARG, &handle_name },
+      { "search_value", AL_ARG, &search_value },
+      { "v",            AL_OPT, &value_name},
+      { "o",            AL_OPT, &outcome_name},
+      { NULL }
+   };
+
+   int retval;
+
+   if ((retval = process_word_list_args(match_glob_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "match_glob")))
+      goto early_exit;
+
+   AHEAD *ahead = ahead_cell(handle_var);
+   if (ahead->glob == NULL)
+   {
+      ate_register_error("handle '%s' was not made by 'make_glob_index' in 'match_glob'",
+                         handle_name);
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   if (search_value == NULL)
+   {
+      ate_register_missing_argument("search_value", "match_glob");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   SHELL_VAR *value_var;
+   if ((retval = create_var_by_given_or_default_name(&value_var,
+                                                     value_name,
+                                                     DEFAULT_VALUE_NAME,
+                                                     "match_glob")))
+      goto early_exit;
+
+   SHELL_VAR *outcome_var;
+   if ((retval = create_var_by_given_or_default_name(&outcome_var,
+                                                     outcome_name,
+                                                     DEFAULT_OUTCOME_NAME,
+                                                     "match_glob")))
+      goto early_exit;
+
+   int row = glob_index_match(ahead, search_value);
+
+   set_var_from_int(outcome_var, row < 0 ? 0 : 1);
+   if (row >= 0)
+      set_var_from_int(value_var, row);
+
+  early_exit:
+   return retval;
+}
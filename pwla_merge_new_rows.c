@@ -0,0 +1,257 @@
+/**
+ * @file pwla_merge_new_rows.c
+ * @brief `merge_new_rows` action implementation
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+
+/**
+ * @brief Add key rows for new table rows to the array of a key handle
+ *
+ * Each new key row is the key values copied from the source row and
+ * the index of the source row, like the rows made by `make_key`.
+ *
+ * @param "key_rows"    [out] vector to receive the new key row heads
+ * @param "key_array"   [in]  array of the key handle
+ * @param "source_head" [in]  handle whose new rows are to be keyed
+ * @param "order"       [in]  recorded order of the key handle
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int merge_new_rows_add_keys(ARRAY_ELEMENT **key_rows,
+                                   SHELL_VAR *key_array,
+                                   const AHEAD *source_head,
+                                   const SORDER *order)
+{
+   const SSPEC *spec = order->spec;
+   for (int i=0; i < spec->count; ++i)
+   {
+      if (spec->columns[i].source >= source_head->row_size)
+      {
+         ate_register_error("key column %d is out of range for row size %d in merge_new_rows",
+                            spec->columns[i].source, source_head->row_size);
+         return EX_USAGE;
+      }
+   }
+
+   ARRAY *target_array = array_cell(key_array);
+   arrayind_t array_index = array_max_index(target_array) + 1;
+
+   // For use with snprintf to stringify numbers for array elements
+   char number_buffer[32];
+
+   for (int row_index = order->source_rows; row_index < source_head->row_count; ++row_index)
+   {
+      for (int i=0; i < spec->count; ++i)
+      {
+         ARRAY_ELEMENT *col = source_head->rows[row_index];
+         for (int field_index=0; field_index < spec->columns[i].source; ++field_index)
+            col = col->next;
+
+         array_insert(target_array, array_index++, col->value);
+         // Elements added past the maximum index are at the end of the list
+         if (i == 0)
+            *key_rows++ = element_back(target_array->head);
+      }
+
+      snprintf(number_buffer, sizeof(number_buffer), "%d", row_index);
+      array_insert(target_array, array_index++, number_buffer);
+   }
+
+   return EXECUTION_SUCCESS;
+}
+
+/**
+ * @brief Merge rows added to a table into an existing sorted or key handle
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * Only the new rows are sorted.  They are then merged into the
+ * already-ordered rows, so adding k rows to an order of N rows costs
+ * O(k log k + N) instead of the O(N log N) of a full sort.
+ *
+ * see man ate(1)
+ */
+int pwla_merge_new_rows(ARG_LIST *alist)
+{
+   const char *sorted_handle_name = NULL;
+   const char *source_handle_name = NULL;
+
+   ARG_TARGET merge_new_rows_targets[] = {
+      { "sorted_handle_name", AL_ARG, &sorted_handle_name},
+      { "source_handle_name", AL_ARG, &source_handle_name},
+      { NULL }
+   };
+
+   int retval;
+
+   // Checked on early exit, must be initialized
+   AHEAD *new_head = NULL;
+   SREC *records = NULL;
+   SREC **merge_order = NULL;
+
+   if ((retval = process_word_list_args(merge_new_rows_targets, alist, AL_NO_OPTIONS)))
+       goto early_exit;
+
+   SHELL_VAR *sorted_var, *source_var;
+   if ((retval = get_handle_var_by_name_or_fail(&sorted_var,
+                                                sorted_handle_name,
+                                                "merge_new_rows")))
+      goto early_exit;
+
+   if ((retval = get_table_handle_var_by_name_or_fail(&source_var,
+                                                      source_handle_name,
+                                                      "merge_new_rows")))
+      goto early_exit;
+
+   AHEAD *sorted_head = ahead_cell(sorted_var);
+   AHEAD *source_head = ahead_cell(source_var);
+   const SORDER *order = sorted_head->order;
+
+   retval = EX_USAGE;
+
+   if (order == NULL || order->key_column == SORDER_FUNCTION_KEY)
+   {
+      ate_register_error("handle '%s' was not made by 'sort -k' or 'make_key -c',"
+                         " so it can't be used in merge_new_rows", sorted_handle_name);
+      goto early_exit;
+   }
+
+   // The source row indexes of a native key would have to move with its rows
+   if (sorted_head->key_rows)
+   {
+      ate_register_error("native key '%s' (make_key -n) cannot be used in merge_new_rows,"
+                         " make it again instead", sorted_handle_name);
+      goto early_exit;
+   }
+
+   if (source_head->array != order->source_array)
+   {
+      ate_register_error("handle '%s' is not a handle of the table ordered by '%s'"
+                         " in merge_new_rows", source_handle_name, sorted_handle_name);
+      goto early_exit;
+   }
+
+   if (source_head->row_count < order->source_rows)
+   {
+      ate_register_error("handle '%s' has fewer rows than were ordered by '%s'"
+                         " in merge_new_rows", source_handle_name, sorted_handle_name);
+      goto early_exit;
+   }
+
+   // Rows may have been resized since the order was recorded
+   if (order->key_column == SORDER_TABLE_ROWS)
+   {
+      for (int i=0; i < order->spec->count; ++i)
+      {
+         if (order->spec->columns[i].column >= source_head->row_size)
+         {
+            ate_register_error("sort column %d is out of range for row size %d"
+                               " in merge_new_rows",
+                               order->spec->columns[i].column, source_head->row_size);
+            goto early_exit;
+         }
+      }
+   }
+
+   retval = EXECUTION_SUCCESS;
+
+   int old_count = sorted_head->row_count;
+   int new_count = source_head->row_count - order->source_rows;
+   int row_count = old_count + new_count;
+
+   // Nothing appended since the handle was ordered
+   if (new_count == 0)
+      goto early_exit;
+
+   retval = EXECUTION_FAILURE;
+
+   new_head = (AHEAD*)xmalloc(ate_calculate_head_size(row_count));
+   if (!ate_initialize_head(new_head, sorted_head->array, sorted_head->row_size))
+   {
+      ate_register_unexpected_error("initializing the merged handle");
+      goto early_exit;
+   }
+
+   memcpy(new_head->rows, sorted_head->rows, old_count * sizeof(ARRAY_ELEMENT*));
+   new_head->row_count = row_count;
+
+   if (order->key_column >= 0)
+   {
+      if ((retval = merge_new_rows_add_keys(&new_head->rows[old_count],
+                                            sorted_head->array,
+                                            source_head,
+                                            order)))
+         goto early_exit;
+      retval = EXECUTION_FAILURE;
+   }
+   else
+      memcpy(&new_head->rows[old_count],
+             &source_head->rows[order->source_rows],
+             new_count * sizeof(ARRAY_ELEMENT*));
+
+   if (!sort_records_create(&records, new_head, order->spec))
+   {
+      ate_register_unexpected_error("preparing rows for sorting");
+      goto early_exit;
+   }
+
+   merge_order = (SREC**)xmalloc(row_count * sizeof(SREC*));
+   for (int i=0; i < row_count; ++i)
+      merge_order[i] = &records[i];
+
+   // Sort only the new rows, then merge them into the ordered rows
+   if (!ate_stable_sort((void**)&merge_order[old_count],
+                        new_count,
+                        sort_records_sort_callback,
+                        (void*)order->spec)
+       || !ate_merge_runs((void**)merge_order,
+                          old_count,
+                          row_count,
+                          sort_records_sort_callback,
+                          (void*)order->spec))
+   {
+      ate_register_unexpected_error("merging rows");
+      goto early_exit;
+   }
+
+   for (int i=0; i < row_count; ++i)
+      new_head->rows[i] = merge_order[i]->row;
+
+   // Record the order before the old head, and its order, are freed.
+   // Collated keys and search aids are saved with the order for seek_key.
+   SOEXTRAS extras = { order->eytzinger_rows != NULL,
+                       order->bloom ? order->bloom->bits_per_key : 0 };
+   if (!sort_order_append(&new_head,
+                          order->source_array,
+                          source_head->row_count,
+                          order->key_column,
+                          order->spec,
+                          order->collation ? merge_order : NULL,
+                          &extras))
+   {
+      ate_register_unexpected_error("recording the merged order");
+      goto early_exit;
+   }
+
+   ate_install_head_in_handle(sorted_var, new_head);
+   new_head = NULL;
+
+   retval = EXECUTION_SUCCESS;
+
+  early_exit:
+   if (merge_order)
+      xfree(merge_order);
+   if (records)
+      xfree(records);
+   if (new_head)
+      xfree(new_head);
+
+   return retval;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file pwla_seek_hash.c
+ * @brief `seek_hash` action implementation
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_hash.h"
+
+/**
+ * @brief Find the rows whose hashed column equals a search value
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * The index of the first matching row is saved to the value
+ * variable, and if requested, the indexes of every matching row, in
+ * table order, are saved to an array.  As with `seek_key`, the
+ * outcome variable reports 1 for a match or 0 for no match.
+ *
+ * see man ate(1)
+ */
+int pwla_seek_hash(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *search_value = NULL;
+   const char *value_name = NULL;
+   const char *array_name = NULL;
+   const char *outcome_name = NULL;
+
+   ARG_TARGET seek_hash_targets[] = {
+      { "handle_name",  AL_ARG, &handle_name },
+      { "search_value", AL_ARG, &search_value },
+      { "v",            AL_OPT, &value_name},
+      { "a",            AL_OPT, &array_name},
+      { "o",            AL_OPT, &outcome_name},
+      { NULL }
+   };
+
+   int retval;
+
+   if ((retval = process_word_list_args(seek_hash_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "seek_hash")))
+      goto early_exit;
+
+   AHEAD *ahead = ahead_cell(handle_var);
+   if (ahead->hash == NULL)
+   {
+      ate_register_error("handle '%s' was not made by 'make_hash' in 'seek_hash'",
+                         handle_name);
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   if (search_value == NULL)
+   {
+      ate_register_missing_argument("search_value", "seek_hash");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   SHELL_VAR *value_var;
+   if ((retval = create_var_by_given_or_default_name(&value_var,
+                                                     value_name,
+                                                     DEFAULT_VALUE_NAME,
+                                                     "seek_hash")))
+      goto early_exit;
+
+   SHELL_VAR *outcome_var;
+   if ((retval = create_var_by_given_or_default_name(&outcome_var,
+                                                     outcome_name,
+                                                     DEFAULT_OUTCOME_NAME,
+                                                     "seek_hash")))
+      goto early_exit;
+
+   SHELL_VAR *array_var = NULL;
+   if (array_name
+       && (retval = create_array_var_by_given_or_default_name(&array_var,
+                                                              array_name,
+                                                              NULL,
+                                                              "seek_hash")))
+      goto early_exit;
+
+   int row = hash_index_find(ahead, search_value);
+
+   set_var_from_int(outcome_var, row < 0 ? 0 : 1);
+   if (row >= 0)
+      set_var_from_int(value_var, row);
+
+   if (array_var)
+   {
+      ARRAY *array = array_cell(array_var);
+      char number_buffer[32];
+      arrayind_t index = 0;
+
+      for (; row >= 0; row = hash_index_next(ahead, row))
+      {
+         snprintf(number_buffer, sizeof(number_buffer), "%d", row);
+         array_insert(array, index++, number_buffer);
+      }
+   }
+
+  early_exit:
+   return retval;
+}
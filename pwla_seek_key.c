@@ -6,11 +6,18 @@
 #include "ate_handle.h"
 #include "ate_utilities.h"
 #include "ate_errors.h"
+#include "ate_sort.h"
 
 #include "word_list_stack.h"
 
 typedef int (*pwla_comp_func)(const char*, const char*);
 
+#ifdef __GNUC__
+#define SEEK_KEY_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define SEEK_KEY_PREFETCH(addr)
+#endif
+
 /**
  * @brief Ultimate determinor of comparison function to use by @ref pwla_seek_key
  *
@@ -58,6 +65,489 @@ int debug_comp(const char *left, const char *right)
 }
 
 
+/**
+ * @brief Get the value by which a key row is searched, which is
+ *        the saved `strxfrm` transformation of a collated key.
+ */
+static inline const char *seek_key_value(const AHEAD *head,
+                                         const char **collation,
+                                         ARRAY_ELEMENT **row)
+{
+   return collation ? collation[row - head->rows] : (*row)->value;
+}
+
+/**
+ * @brief A search value and how to compare it to the key rows
+ */
+typedef struct seek_key_probe {
+   const AHEAD    *head;       ///< key table being searched
+   const char     **collation; ///< saved collation keys, if a collated key
+   const uint64_t *prefixes;   ///< saved key prefixes, if to be compared first
+   const uint64_t *eytzinger_prefixes; ///< prefixes in Eytzinger order, if any
+   const int32_t  *eytzinger_rows;     ///< row index of each Eytzinger slot
+   pwla_comp_func pcomp;       ///< comparison of full key values
+   const char     *value;      ///< search value, transformed if collated
+   uint64_t       prefix;      ///< packed prefix of @p value
+} SKPROBE;
+
+/**
+ * @brief Prepare to search for a value
+ *
+ * Saved key prefixes are only compared when keys are compared as
+ * plain strings.  Integer, tallied, and debugging comparisons all go
+ * through @p pcomp so that every comparison is counted.  The same
+ * holds for the Eytzinger layout of a key made with `make_key -E`.
+ */
+static void seek_key_probe_init(SKPROBE *probe,
+                                const AHEAD *head,
+                                const char **collation,
+                                pwla_comp_func pcomp,
+                                const char *value)
+{
+   probe->head = head;
+   probe->collation = collation;
+   probe->prefixes = NULL;
+   probe->eytzinger_prefixes = NULL;
+   probe->eytzinger_rows = NULL;
+   probe->pcomp = pcomp;
+   probe->value = value;
+   probe->prefix = 0;
+
+   if (pcomp == strcmp && head->order && head->order->prefixes)
+   {
+      probe->prefixes = head->order->prefixes;
+      probe->eytzinger_prefixes = head->order->eytzinger_prefixes;
+      probe->eytzinger_rows = head->order->eytzinger_rows;
+      probe->prefix = sort_key_prefix(value);
+   }
+}
+
+/**
+ * @brief Compare a key row to the search value, like @p pcomp
+ *
+ * The contiguous saved prefixes settle most comparisons without
+ * reading the row's element or string.  Only rows whose prefix equals
+ * that of the search value are compared in full.
+ */
+static inline int seek_key_compare(const SKPROBE *probe, ARRAY_ELEMENT **row)
+{
+   if (probe->prefixes)
+   {
+      uint64_t key_prefix = probe->prefixes[row - probe->head->rows];
+      if (key_prefix != probe->prefix)
+         return key_prefix < probe->prefix ? -1 : 1;
+
+      // Equal prefixes of a string shorter than eight bytes
+      if ((probe->prefix & 0xff) == 0)
+         return 0;
+   }
+
+   return (*probe->pcomp)(seek_key_value(probe->head, probe->collation, row),
+                          probe->value);
+}
+
+/**
+ * @brief Find the first key row whose value is not less than the
+ *        value of @p probe
+ *
+ * If @p gallop is set, the rows before @p lo are known to be less than
+ * the search value, as when searching for each of a sorted list of
+ * values.  Rows are then probed at exponentially growing distances
+ * from @p lo before a binary search of the bracketed range, so a
+ * target near the previous one costs only a few comparisons.
+ *
+ * @param "probe"     [in] search value and comparison
+ * @param "lo"        [in] index from which to gallop
+ * @param "gallop"    [in] True to gallop from @p lo, False to search all rows
+ * @return index of the first row not less than the search value, or
+ *         the row count if every row is less
+ */
+static int seek_key_lower_bound(const SKPROBE *probe, int lo, bool gallop)
+{
+   ARRAY_ELEMENT **rows = (ARRAY_ELEMENT**)probe->head->rows;
+   int hi = probe->head->row_count;
+
+   if (gallop)
+   {
+      int step = 1;
+      int probe_index = lo;
+      while (probe_index < hi)
+      {
+         if (seek_key_compare(probe, &rows[probe_index]) >= 0)
+         {
+            hi = probe_index;
+            break;
+         }
+
+         lo = probe_index + 1;
+         probe_index = lo + step;
+         step <<= 1;
+      }
+   }
+   else
+      lo = 0;
+
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      if (seek_key_compare(probe, &rows[mid]) >= 0)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+
+   return lo;
+}
+
+/**
+ * @brief Find the first key row whose value is not less than the
+ *        value of @p probe in a key's Eytzinger layout
+ *
+ * The search steps from slot k to slot 2k or 2k+1 by the result of a
+ * comparison instead of branching on it, and prefetches the slots
+ * three levels down, which share a cache line.  Strings are only
+ * compared for slots whose prefix equals that of the search value.
+ *
+ * @param "probe"  [in] search value, with the Eytzinger layout
+ * @return index of the first row not less than the search value, or
+ *         the row count if every row is less
+ */
+static int seek_key_eytzinger_lower_bound(const SKPROBE *probe)
+{
+   const uint64_t *prefixes = probe->eytzinger_prefixes;
+   const int32_t *rows = probe->eytzinger_rows;
+   int slot_count = probe->head->row_count + 1;
+   int slot = 1;
+
+   while (slot < slot_count)
+   {
+      SEEK_KEY_PREFETCH(&prefixes[8 * slot < slot_count ? 8 * slot : 0]);
+
+      uint64_t key_prefix = prefixes[slot];
+      int less = key_prefix < probe->prefix;
+      if (key_prefix == probe->prefix && (probe->prefix & 0xff) != 0)
+      {
+         ARRAY_ELEMENT **row = (ARRAY_ELEMENT**)&probe->head->rows[rows[slot]];
+         less = strcmp(seek_key_value(probe->head, probe->collation, row), probe->value) < 0;
+      }
+
+      slot = 2 * slot + less;
+   }
+
+   // Undo the final run of steps to the right, then the step to the
+   // left from the last slot that was not less than the search value.
+   while (slot & 1)
+      slot >>= 1;
+   slot >>= 1;
+
+   return rows[slot];
+}
+
+/**
+ * @brief Integer value of a key, 0 if the key is not an integer as
+ *        when the key was sorted by `make_key -i`
+ */
+static inline long seek_key_long(const ARRAY_ELEMENT *row)
+{
+   long value = 0;
+   get_long_from_string(&value, row->value);
+   return value;
+}
+
+/**
+ * @brief Find the first key row not less than an integer search value
+ *        by interpolation search
+ *
+ * Each probe is placed where the search value would fall if the keys
+ * between the bounds were evenly spaced, so sequential or uniform
+ * keys are found in a few probes.  A probe that fails to halve the
+ * range suggests skewed keys and is followed by a bisection, so the
+ * search never takes much more than twice the probes of a binary
+ * search.
+ *
+ * @param "head"         [in] key table of ascending integer keys
+ * @param "pcomp"        [in] comparison function, possibly tallying
+ * @param "search_value" [in] search value string, for @p pcomp
+ * @param "target"       [in] integer value of @p search_value
+ * @return index of the first row not less than the search value, or
+ *         the row count if every row is less
+ */
+static int seek_key_interpolate(const AHEAD *head,
+                                pwla_comp_func pcomp,
+                                const char *search_value,
+                                long target)
+{
+   ARRAY_ELEMENT **rows = (ARRAY_ELEMENT**)head->rows;
+   int lo = 0;
+   int hi = head->row_count - 1;
+
+   if (hi < 0 || (*pcomp)(rows[lo]->value, search_value) >= 0)
+      return 0;
+   if ((*pcomp)(rows[hi]->value, search_value) < 0)
+      return head->row_count;
+
+   // Keys at lo are less than the target, keys at hi are not
+   long lo_key = seek_key_long(rows[lo]);
+   long hi_key = seek_key_long(rows[hi]);
+   bool bisect = False;
+
+   while (hi - lo > 1)
+   {
+      int span = hi - lo;
+      int pos;
+      if (bisect || hi_key <= lo_key)
+         pos = lo + span / 2;
+      else
+      {
+         double fraction = ((double)target - (double)lo_key) / ((double)hi_key - (double)lo_key);
+         // Rounding of very large keys can leave the fraction outside
+         // [0,1], where the conversion to int would be undefined
+         if (!(fraction > 0.0))
+            fraction = 0.0;
+         else if (fraction > 1.0)
+            fraction = 1.0;
+         pos = lo + (int)(fraction * span);
+         if (pos <= lo)
+            pos = lo + 1;
+         else if (pos >= hi)
+            pos = hi - 1;
+      }
+
+      if ((*pcomp)(rows[pos]->value, search_value) < 0)
+      {
+         lo = pos;
+         lo_key = seek_key_long(rows[pos]);
+      }
+      else
+      {
+         hi = pos;
+         hi_key = seek_key_long(rows[pos]);
+      }
+
+      bisect = !bisect && (hi - lo) * 2 > span;
+   }
+
+   return hi;
+}
+
+/**
+ * @brief Compare the leading columns of a composite key row to
+ *        search values, column by column, counting the comparison
+ * @param "spec"   [in] order of the key rows
+ * @param "row"    [in] first element of a key row
+ * @param "values" [in] search value for each of the first @p count columns
+ * @param "count"  [in] number of search values
+ */
+static int seek_key_composite_compare(const SSPEC *spec,
+                                      ARRAY_ELEMENT *row,
+                                      const SVALUE *values,
+                                      int count)
+{
+   ++pwla_comp_tally;
+
+   for (int i=0; i < count; ++i, row = row->next)
+   {
+      const SCOL *col = &spec->columns[i];
+      int comp;
+      if (col->numeric)
+      {
+         long num = 0;
+         get_long_from_string(&num, row->value);
+         comp = num < values[i].num ? -1 : (num > values[i].num ? 1 : 0);
+      }
+      else
+         comp = strcmp(row->value, values[i].str);
+
+      if (comp)
+         return col->reverse ? -comp : comp;
+   }
+
+   return 0;
+}
+
+/**
+ * @brief Search a composite key made by `make_key -c 1,3n`
+ *
+ * Rows are compared by as many leading key columns as there are
+ * search values, so a search for fewer values than key columns finds
+ * the first row of the matching group.
+ *
+ * @param "head"       [in]  key table to search
+ * @param "values"     [in]  search values, one per leading key column
+ * @param "count"      [in]  number of search values
+ * @param "permissive" [in]  accept the next greater key
+ * @param "sequential" [in]  search the key rows sequentially
+ * @param "index"      [out] index of the found key row
+ * @return search outcome, 0 for no match, 1 for an exact match or 2
+ *         for a greater key accepted by @p permissive
+ */
+static int seek_key_composite(const AHEAD *head,
+                              const SVALUE *values,
+                              int count,
+                              bool permissive,
+                              bool sequential,
+                              int *index)
+{
+   const SSPEC *spec = head->order->spec;
+   int lo = 0;
+   int hi = head->row_count;
+
+   if (sequential)
+   {
+      for (lo = 0; lo < hi; ++lo)
+         if (0 == seek_key_composite_compare(spec, head->rows[lo], values, count))
+            break;
+   }
+   else
+   {
+      while (lo < hi)
+      {
+         int mid = lo + (hi - lo) / 2;
+         if (seek_key_composite_compare(spec, head->rows[mid], values, count) >= 0)
+            hi = mid;
+         else
+            lo = mid + 1;
+      }
+   }
+
+   if (lo == head->row_count)
+      return 0;
+
+   *index = lo;
+
+   // Not tallied, as with the final test of the ordinary search
+   int tally = pwla_comp_tally;
+   int comp = seek_key_composite_compare(spec, head->rows[lo], values, count);
+   pwla_comp_tally = tally;
+
+   if (comp == 0)
+      return 1;
+
+   return permissive && !sequential ? 2 : 0;
+}
+
+/**
+ * @brief Search a key table for every value of an array
+ *
+ * For each search value, in order, a key row index and a search
+ * outcome are appended to @p results_var, with the same meanings as
+ * the single-value search.  The index is -1 for an outcome of 0.
+ *
+ * While the search values are in ascending order, each search
+ * gallops forward from the previous result instead of starting over.
+ * Values ruled out by the key's Bloom filter (make_key -B) are not
+ * searched at all.
+ *
+ * @param "head"        [in] key table to search
+ * @param "collation"   [in] saved collation keys, if a collated key
+ * @param "pcomp"       [in] comparison function, possibly tallying
+ * @param "search_var"  [in] array of search values
+ * @param "results_var" [in] empty array to receive index, outcome pairs
+ * @param "permissive"  [in] accept the next greater key
+ * @param "sequential"  [in] search the key rows sequentially
+ * @return EXECUTION_SUCCESS
+ */
+static int seek_key_batch(const AHEAD *head,
+                          const char **collation,
+                          pwla_comp_func pcomp,
+                          SHELL_VAR *search_var,
+                          SHELL_VAR *results_var,
+                          bool permissive,
+                          bool sequential)
+{
+   ARRAY *search_array = array_cell(search_var);
+   ARRAY *results = array_cell(results_var);
+   ARRAY_ELEMENT **rows = (ARRAY_ELEMENT**)head->rows;
+
+   // For use with snprintf to stringify numbers for array elements
+   char number_buffer[32];
+
+   char *collated_search = NULL;
+   const char *prev_value = NULL;
+   char *prev_collated = NULL;
+   int prev_index = 0;
+
+   // Only exact string matches can be ruled out by a Bloom filter
+   const BLOOM *bloom = NULL;
+   if (head->order && !permissive && pwla_sort_func == strcmp)
+      bloom = head->order->bloom;
+   arrayind_t result_index = 0;
+
+   ARRAY_ELEMENT *end = search_array->head;
+   ARRAY_ELEMENT *el = end->next;
+   while (el != end)
+   {
+      const char *value = el->value ? el->value : "";
+      if (collation)
+         value = collated_search = sort_collation_key(value);
+
+      SKPROBE probe;
+      seek_key_probe_init(&probe, head, collation, pcomp, value);
+
+      int index = head->row_count;
+      // A value ruled out by the Bloom filter needs no search
+      bool ruled_out = bloom && !bloom_filter_test(bloom, value);
+      if (ruled_out)
+         index = head->row_count;
+      else if (sequential)
+      {
+         for (index = 0; index < head->row_count; ++index)
+            if (0 == seek_key_compare(&probe, &rows[index]))
+               break;
+      }
+      else if (probe.eytzinger_rows)
+         index = seek_key_eytzinger_lower_bound(&probe);
+      else
+      {
+         // Values in ascending order can gallop from the last result
+         bool gallop = prev_value && (*pwla_sort_func)(prev_value, value) <= 0;
+         index = seek_key_lower_bound(&probe, prev_index, gallop);
+         prev_index = index;
+      }
+
+      int outcome = 0;
+      if (index < head->row_count)
+      {
+         if (0 == strcmp(seek_key_value(head, collation, &rows[index]), value))
+            outcome = 1;
+         else if (permissive && !sequential)
+            outcome = 2;
+      }
+
+      if (outcome == 0)
+         index = -1;
+
+      snprintf(number_buffer, sizeof(number_buffer), "%d", index);
+      array_insert(results, result_index++, number_buffer);
+      snprintf(number_buffer, sizeof(number_buffer), "%d", outcome);
+      array_insert(results, result_index++, number_buffer);
+
+      // Keep this value for the order test of the next value.  A
+      // value that was not searched leaves prev_index behind it, so
+      // the next value is compared with the last searched value.
+      if (ruled_out)
+      {
+         if (collated_search)
+            xfree(collated_search);
+      }
+      else
+      {
+         if (prev_collated)
+            xfree(prev_collated);
+         prev_collated = collated_search;
+         prev_value = value;
+      }
+      collated_search = NULL;
+
+      el = el->next;
+   }
+
+   if (prev_collated)
+      xfree(prev_collated);
+
+   return EXECUTION_SUCCESS;
+}
+
 /**
  * @brief Get index to key row whose value is equal to or greater than the target value
  *
@@ -83,7 +573,8 @@ int pwla_seek_key(ARG_LIST *alist)
    const char *handle_name = NULL;
    const char *search_value = NULL;
    const char *value_name = NULL;
-   const char *wrong_type = NULL;
+   const char *results_array_name = NULL;
+   const char *search_array_name = NULL;
    const char *comp_tally_name = NULL;
    const char *outcome_name = NULL;
    const char *debug_flag = NULL;
@@ -95,7 +586,8 @@ int pwla_seek_key(ARG_LIST *alist)
       { "handle_name",  AL_ARG, &handle_name },
       { "search_value", AL_ARG, &search_value },
       { "v",            AL_OPT, &value_name},
-      { "a",            AL_OPT, &wrong_type},
+      { "a",            AL_OPT, &results_array_name},
+      { "A",            AL_OPT, &search_array_name},
       { "t",            AL_OPT, &comp_tally_name},
       { "o",            AL_OPT, &outcome_name},
       { "d",            AL_FLAG, &debug_flag},
@@ -109,7 +601,7 @@ int pwla_seek_key(ARG_LIST *alist)
    if (retval)
       goto early_exit;
 
-   if (wrong_type)
+   if (results_array_name && !search_array_name)
    {
       ate_register_wrong_report_type('a', "seek_key");
       retval = EX_USAGE;
@@ -122,21 +614,50 @@ int pwla_seek_key(ARG_LIST *alist)
                                                 "seek_key")))
       goto early_exit;
 
-   SHELL_VAR *value_var;
-   if ((retval = create_var_by_given_or_default_name(&value_var,
-                                                     value_name,
-                                                     DEFAULT_VALUE_NAME,
-                                                     "seek_key")))
-      goto early_exit;
+   // A batch search (-A) reports results in an array instead of variables
+   SHELL_VAR *search_array_var = NULL, *results_var = NULL;
+   SHELL_VAR *value_var = NULL, *outcome_var = NULL;
+   if (search_array_name)
+   {
+      if ((retval = get_array_var_by_name_or_fail(&search_array_var,
+                                                  search_array_name,
+                                                  "seek_key")))
+         goto early_exit;
 
-   SHELL_VAR *outcome_var;
-   if ((retval = create_var_by_given_or_default_name(&outcome_var,
-                                                     outcome_name,
-                                                     DEFAULT_OUTCOME_NAME,
-                                                     "seek_key")))
-      goto early_exit;
+      // The results array is emptied before the search, so it cannot
+      // be the search array, whether named by -a, by default or
+      // through a nameref
+      const char *results_name = results_array_name ? results_array_name : DEFAULT_ARRAY_NAME;
+      if (find_variable(results_name) == search_array_var)
+      {
+         ate_register_error("search array '%s' cannot also be the results array in 'seek_key'",
+                            search_array_name);
+         retval = EX_USAGE;
+         goto early_exit;
+      }
+
+      if ((retval = create_array_var_by_given_or_default_name(&results_var,
+                                                              results_array_name,
+                                                              DEFAULT_ARRAY_NAME,
+                                                              "seek_key")))
+         goto early_exit;
+   }
+   else
+   {
+      if ((retval = create_var_by_given_or_default_name(&value_var,
+                                                        value_name,
+                                                        DEFAULT_VALUE_NAME,
+                                                        "seek_key")))
+         goto early_exit;
+
+      if ((retval = create_var_by_given_or_default_name(&outcome_var,
+                                                        outcome_name,
+                                                        DEFAULT_OUTCOME_NAME,
+                                                        "seek_key")))
+         goto early_exit;
+   }
 
-   if (search_value == NULL)
+   if (search_value == NULL && search_array_var == NULL)
    {
       ate_register_missing_argument("search_value", "seek_key");
       retval = EX_USAGE;
@@ -155,6 +676,71 @@ int pwla_seek_key(ARG_LIST *alist)
     * comp_tally_name test.
     */
 
+   AHEAD *ahead = ahead_cell(handle_var);
+
+   // A composite key (make_key -c 1,3n) is searched column by column,
+   // with search values for one or more of its leading columns.
+   const SSPEC *composite_spec = NULL;
+   if (ahead->order
+       && ahead->order->key_column != SORDER_TABLE_ROWS
+       && ahead->order->spec->count > 1)
+      composite_spec = ahead->order->spec;
+
+   int value_count = 1;
+   for (ARG_LIST *extra = alist->next; extra; extra = extra->next)
+      ++value_count;
+
+   if (composite_spec && search_array_var)
+   {
+      ate_register_error("batch search (-A) is not supported for composite key '%s' in 'seek_key'",
+                         handle_name);
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   if (value_count > 1 && (!composite_spec || value_count > composite_spec->count))
+   {
+      ate_register_error("too many search values for key '%s' in 'seek_key'", handle_name);
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   SVALUE *composite_values = NULL;
+   if (composite_spec)
+   {
+      composite_values = (SVALUE*)alloca(value_count * sizeof(SVALUE));
+      ARG_LIST *arg = alist;
+      for (int i=0; i < value_count; ++i)
+      {
+         const char *value = i ? (arg = arg->next)->value : search_value;
+         if (composite_spec->columns[i].numeric)
+         {
+            if (!get_long_from_string(&composite_values[i].num, value))
+            {
+               ate_register_not_an_int(value, "seek_key");
+               retval = EX_USAGE;
+               goto early_exit;
+            }
+         }
+         else
+            composite_values[i].str = value;
+      }
+   }
+
+   // A key made with make_key -l is searched by byte comparisons of
+   // the LC_COLLATE transformations of the keys and the search value.
+   const char **collation = ahead->order ? ahead->order->collation : NULL;
+   char *collated_search = NULL;
+   if (collation)
+   {
+      if (search_value)
+      {
+         collated_search = sort_collation_key(search_value);
+         search_value = collated_search;
+      }
+      int_sort_flag = NULL;
+   }
+
    if (int_sort_flag)
       pwla_sort_func = long_strcmp;
    else
@@ -168,7 +754,7 @@ int pwla_seek_key(ARG_LIST *alist)
                                                         comp_tally_name,
                                                         NULL,
                                                         "seek_key")))
-         goto early_exit;
+         goto discard_collation;
 
       pcomp = tally_comp;
       pwla_comp_tally = 0;
@@ -179,7 +765,8 @@ int pwla_seek_key(ARG_LIST *alist)
    {
       pwla_comp_tally = 0;
       pcomp = debug_comp;
-      printf("\nDebug search for first instance of '%s'\n", search_value);
+      if (search_value)
+         printf("\nDebug search for first instance of '%s'\n", search_value);
    }
 
    // Ruled-out usage errors by now, any outcome should be considered
@@ -189,7 +776,44 @@ int pwla_seek_key(ARG_LIST *alist)
    int permissive_match = permissive_flag==NULL ? 0 : 1;
    int sequential_search = sequential_flag==NULL ? 0 : 1;
 
-   AHEAD *ahead = ahead_cell(handle_var);
+   if (composite_values)
+   {
+      int index = 0;
+      int outcome = seek_key_composite(ahead,
+                                       composite_values,
+                                       value_count,
+                                       permissive_match,
+                                       sequential_search,
+                                       &index);
+      if (outcome)
+         set_var_from_int(value_var, index);
+      set_var_from_int(outcome_var, outcome);
+      goto save_tally;
+   }
+
+   if (search_array_var)
+   {
+      retval = seek_key_batch(ahead,
+                              collation,
+                              pcomp,
+                              search_array_var,
+                              results_var,
+                              permissive_match,
+                              sequential_search);
+      goto save_tally;
+   }
+
+   // A key made with make_key -B rules out most absent values
+   // without comparing any keys
+   if (!permissive_match
+       && !int_sort_flag
+       && ahead->order
+       && ahead->order->bloom
+       && !bloom_filter_test(ahead->order->bloom, search_value))
+      goto giving_up;
+
+   SKPROBE probe;
+   seek_key_probe_init(&probe, ahead, collation, pcomp, search_value);
 
    int ndx_left = 0;
    int ndx_right = ahead->row_count;
@@ -199,6 +823,40 @@ int pwla_seek_key(ARG_LIST *alist)
 
    ARRAY_ELEMENT **ael_ptr, **ael_end;
 
+   // A key made with make_key -E is searched in its Eytzinger layout
+   if (probe.eytzinger_rows && !sequential_search)
+   {
+      int index = seek_key_eytzinger_lower_bound(&probe);
+      if (index == ahead->row_count)
+         goto giving_up;
+
+      ael_ptr = &ahead->rows[index];
+      if (permissive_match || 0 == strcmp(seek_key_value(ahead, collation, ael_ptr), search_value))
+         goto found_value;
+
+      goto giving_up;
+   }
+
+   // Integer keys in ascending order are found by interpolation
+   long search_long;
+   if (int_sort_flag
+       && !sequential_search
+       && !(ahead->order
+            && ahead->order->key_column != SORDER_TABLE_ROWS
+            && ahead->order->spec->columns[0].reverse)
+       && get_long_from_string(&search_long, search_value))
+   {
+      int index = seek_key_interpolate(ahead, pcomp, search_value, search_long);
+      if (index == ahead->row_count)
+         goto giving_up;
+
+      ael_ptr = &ahead->rows[index];
+      if (permissive_match || 0 == (*pwla_sort_func)((*ael_ptr)->value, search_value))
+         goto found_value;
+
+      goto giving_up;
+   }
+
    // Quick and dirty for sequential sort, then skip to exit.
    if (sequential_search)
    {
@@ -206,7 +864,7 @@ int pwla_seek_key(ARG_LIST *alist)
       ael_end = ael_ptr + ahead->row_count;
       while (ael_ptr < ael_end)
       {
-         if (0 == (*pcomp)((*ael_ptr)->value, search_value))
+         if (0 == seek_key_compare(&probe, ael_ptr))
             goto found_value;
          ++ael_ptr;
       }
@@ -242,7 +900,7 @@ int pwla_seek_key(ARG_LIST *alist)
          // if (debug_mode)
          //    printf("key pivot index %d: ", mid);
 
-         int comp = (*pcomp)((*ael_ptr)->value, search_value);
+         int comp = seek_key_compare(&probe, ael_ptr);
          if (comp >= 0)
             ndx_right = mid;
          else
@@ -268,7 +926,7 @@ int pwla_seek_key(ARG_LIST *alist)
 
          while (ael_ptr < ael_end)
          {
-            int comp = (*pcomp)((*ael_ptr)->value, search_value);
+            int comp = seek_key_compare(&probe, ael_ptr);
 
             if (comp==0)
                goto found_value;
@@ -294,7 +952,13 @@ int pwla_seek_key(ARG_LIST *alist)
             if (ael_ptr == ahead->rows+ahead->row_count)
                goto giving_up;
 
-            goto found_value;
+            // otherwise the row past the range is the first greater
+            // or equal row, but only acceptable if equal or permissive.
+            if (permissive_match
+                || 0 == (*pwla_sort_func)(seek_key_value(ahead, collation, ael_ptr), search_value))
+               goto found_value;
+
+            goto giving_up;
          }
       } // end of linear search code block
    }
@@ -309,7 +973,7 @@ int pwla_seek_key(ARG_LIST *alist)
 
   found_value:
    {
-      char *found_value = (*ael_ptr)->value;
+      const char *found_value = seek_key_value(ahead, collation, ael_ptr);
       int comp = strcmp(found_value, search_value);
 
       if (debug_flag)
@@ -334,6 +998,10 @@ int pwla_seek_key(ARG_LIST *alist)
    if (tally_var)
       set_var_from_int(tally_var, pwla_comp_tally);
 
+  discard_collation:
+   if (collated_search)
+      xfree(collated_search);
+
   early_exit:
    return retval;
 }
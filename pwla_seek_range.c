@@ -0,0 +1,296 @@
+/**
+ * @file pwla_seek_range.c
+ * @brief `seek_range` and `seek_prefix` action implementations
+ *
+ * Both actions find the bounds of a run of key rows with two binary
+ * searches and report the run as a starting row index and a row
+ * count, the values expected by the `-s` and `-c` options of
+ * `walk_rows`.
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+
+/**
+ * @brief How to compare the keys of a key table
+ */
+typedef struct key_search {
+   const AHEAD *head;        ///< key table to search
+   const char  **collation;  ///< saved collation keys, if collated
+   const uint64_t *prefixes; ///< saved key prefixes, if string keys
+   bool        numeric;      ///< compare keys as integers
+   bool        reverse;      ///< keys are in descending order
+} KSEARCH;
+
+/**
+ * @brief Prepare a key search from what the key handle recorded
+ *        about its order when it was made.
+ * @param "ks"           [out] search to prepare
+ * @param "head"         [in]  key table
+ * @param "int_sort_flag" [in] True if the user requested integer keys (`-i`)
+ */
+static void key_search_init(KSEARCH *ks, const AHEAD *head, bool int_sort_flag)
+{
+   ks->head = head;
+   ks->collation = NULL;
+   ks->prefixes = NULL;
+   ks->numeric = int_sort_flag;
+   ks->reverse = False;
+
+   // Only a key table's order describes the first column
+   const SORDER *order = head->order;
+   if (order && order->key_column != SORDER_TABLE_ROWS)
+   {
+      ks->collation = order->collation;
+      ks->numeric = ks->numeric || order->spec->columns[0].numeric;
+      ks->reverse = order->spec->columns[0].reverse;
+      if (!ks->numeric)
+         ks->prefixes = order->prefixes;
+   }
+}
+
+/**
+ * @brief Value by which the key of @p row is compared
+ */
+static const char *key_search_value(const KSEARCH *ks, int row)
+{
+   return ks->collation ? ks->collation[row] : ks->head->rows[row]->value;
+}
+
+/**
+ * @brief Find the first row whose key is past @p value in key order
+ * @param "ks"     [in] key search
+ * @param "value"  [in] value to compare
+ * @param "strict" [in] False to include a key equal to @p value,
+ *                      True to find the first key after equal keys
+ * @return row index, or the row count if no key qualifies
+ */
+static int key_search_bound(const KSEARCH *ks, const char *value, bool strict)
+{
+   uint64_t prefix = ks->prefixes ? sort_key_prefix(value) : 0;
+   int lo = 0;
+   int hi = ks->head->row_count;
+
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      int comp;
+      // Full keys are only read when their prefixes match
+      if (ks->prefixes && ks->prefixes[mid] != prefix)
+         comp = ks->prefixes[mid] < prefix ? -1 : 1;
+      else
+      {
+         const char *key = key_search_value(ks, mid);
+         comp = ks->numeric ? long_strcmp(key, value) : strcmp(key, value);
+      }
+      if (ks->reverse)
+         comp = -comp;
+
+      if (comp > 0 || (comp == 0 && !strict))
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+
+   return lo;
+}
+
+/**
+ * @brief Find the first row whose key is past the keys with @p prefix
+ * @param "ks"     [in] key search of string keys
+ * @param "prefix" [in] prefix to compare
+ * @param "strict" [in] False to include keys with the prefix, True to
+ *                      find the first key after them
+ * @return row index, or the row count if no key qualifies
+ */
+static int key_search_prefix_bound(const KSEARCH *ks, const char *prefix, bool strict)
+{
+   size_t len = strlen(prefix);
+   int lo = 0;
+   int hi = ks->head->row_count;
+
+   while (lo < hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      int comp = strncmp(key_search_value(ks, mid), prefix, len);
+      if (ks->reverse)
+         comp = -comp;
+
+      if (comp > 0 || (comp == 0 && !strict))
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+
+   return lo;
+}
+
+/**
+ * @brief Save a row range as a two-element array, start index and count
+ */
+static void save_range(SHELL_VAR *array_var, int start, int end)
+{
+   ARRAY *array = array_cell(array_var);
+   char number_buffer[32];
+
+   snprintf(number_buffer, sizeof(number_buffer), "%d", start);
+   array_insert(array, 0, number_buffer);
+   snprintf(number_buffer, sizeof(number_buffer), "%d", end > start ? end - start : 0);
+   array_insert(array, 1, number_buffer);
+}
+
+/**
+ * @brief Find the key rows with values from @p low_value up to, but
+ *        not including, @p high_value
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_seek_range(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *low_value = NULL;
+   const char *high_value = NULL;
+   const char *array_name = NULL;
+   const char *int_sort_flag = NULL;
+
+   ARG_TARGET seek_range_targets[] = {
+      { "handle_name", AL_ARG, &handle_name },
+      { "low_value",   AL_ARG, &low_value },
+      { "high_value",  AL_ARG, &high_value },
+      { "a",           AL_OPT, &array_name},
+      { "i",           AL_FLAG, &int_sort_flag},
+      { NULL }
+   };
+
+   int retval;
+
+   if ((retval = process_word_list_args(seek_range_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
+                                                handle_name,
+                                                "seek_range")))
+      goto early_exit;
+
+   if (low_value == NULL || high_value == NULL)
+   {
+      ate_register_missing_argument(low_value ? "high_value" : "low_value", "seek_range");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   SHELL_VAR *array_var;
+   if ((retval = create_array_var_by_given_or_default_name(&array_var,
+                                                           array_name,
+                                                           DEFAULT_ARRAY_NAME,
+                                                           "seek_range")))
+      goto early_exit;
+
+   KSEARCH ks;
+   key_search_init(&ks, ahead_cell(handle_var), int_sort_flag != NULL);
+
+   // Collated keys are compared by their strxfrm transformations
+   char *collated_low = NULL, *collated_high = NULL;
+   if (ks.collation)
+   {
+      low_value = collated_low = sort_collation_key(low_value);
+      high_value = collated_high = sort_collation_key(high_value);
+   }
+
+   int start, end;
+   if (ks.reverse)
+   {
+      start = key_search_bound(&ks, high_value, True);
+      end = key_search_bound(&ks, low_value, True);
+   }
+   else
+   {
+      start = key_search_bound(&ks, low_value, False);
+      end = key_search_bound(&ks, high_value, False);
+   }
+
+   save_range(array_var, start, end);
+
+   if (collated_low)
+      xfree(collated_low);
+   if (collated_high)
+      xfree(collated_high);
+
+  early_exit:
+   return retval;
+}
+
+/**
+ * @brief Find the key rows whose values begin with a prefix
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_seek_prefix(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *prefix = NULL;
+   const char *array_name = NULL;
+
+   ARG_TARGET seek_prefix_targets[] = {
+      { "handle_name", AL_ARG, &handle_name },
+      { "prefix",      AL_ARG, &prefix },
+      { "a",           AL_OPT, &array_name},
+      { NULL }
+   };
+
+   int retval;
+
+   if ((retval = process_word_list_args(seek_prefix_targets, alist, 0)))
+      goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
+                                                handle_name,
+                                                "seek_prefix")))
+      goto early_exit;
+
+   if (prefix == NULL)
+   {
+      ate_register_missing_argument("prefix", "seek_prefix");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   KSEARCH ks;
+   key_search_init(&ks, ahead_cell(handle_var), False);
+
+   // Prefixes are only contiguous in byte order
+   if (ks.numeric || ks.collation)
+   {
+      ate_register_error("key '%s' is not in string order, as needed by 'seek_prefix'",
+                         handle_name);
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   SHELL_VAR *array_var;
+   if ((retval = create_array_var_by_given_or_default_name(&array_var,
+                                                           array_name,
+                                                           DEFAULT_ARRAY_NAME,
+                                                           "seek_prefix")))
+      goto early_exit;
+
+   int start = key_search_prefix_bound(&ks, prefix, False);
+   int end = key_search_prefix_bound(&ks, prefix, True);
+
+   save_range(array_var, start, end);
+
+  early_exit:
+   return retval;
+}
@@ -1,6 +1,6 @@
 /**
  * @file pwla_sort.c
- * @brief `sort` action implementation with qsort support function
+ * @brief `sort` action implementation with stable sort support functions
  */
 
 #include <builtins.h>
@@ -15,36 +15,54 @@
 #include "ate_handle.h"
 #include "ate_utilities.h"
 #include "ate_errors.h"
+#include "ate_sort.h"
 #include "pwla.h"
 #include "word_list_stack.h"
 
 struct sort_data {
    int row_size;
-   SHELL_VAR *func_var;
+   const PREPFUNC *callback;
    SHELL_VAR *return_var;
    SHELL_VAR *left_var;
    SHELL_VAR *right_var;
-   WORD_LIST *args;
+   RPROJ *projection;
+   RBUFS left_buffers;
+   RBUFS right_buffers;
 };
 
 /**
- * @brief Transfer function between C-library qsort and a Bash shell comparison function
- * @param "left"  [in] pointer to left-side element
- * @param "right" [in] pointer to right-side element
+ * @brief Copy a row, or its projected columns, to a callback array
+ */
+static int sort_fill_row_array(SHELL_VAR *target_var,
+                               ARRAY_ELEMENT *row,
+                               int row_size,
+                               RPROJ *projection,
+                               RBUFS *rbufs)
+{
+   if (projection)
+      return update_projected_row_array(target_var, row, projection, rbufs);
+   else
+      return update_row_array(target_var, row, row_size, rbufs);
+}
+
+/**
+ * @brief Transfer function between @ref ate_stable_sort and a Bash shell comparison function
+ * @param "left"  [in] left-side row head ARRAY_ELEMENT*
+ * @param "right" [in] right-side row head ARRAY_ELEMENT*
  * @param "arg"   [in] void* to a @ref sort_data structure
  * @return -1 if left < right, 0 if left == right, 1 if left > right
  */
-int pwla_sort_qsort_callback(const void *left, const void *right, void *arg)
+int pwla_sort_callback(const void *left, const void *right, void *arg)
 {
    struct sort_data *data = (struct sort_data*)arg;
 
    // Prepre the rows for comparison
-   ARRAY_ELEMENT *left_el = *(ARRAY_ELEMENT**)left;
-   ARRAY_ELEMENT *right_el = *(ARRAY_ELEMENT**)right;
-   assert(EXECUTION_SUCCESS == update_row_array(data->left_var, left_el, data->row_size));
-   assert(EXECUTION_SUCCESS == update_row_array(data->right_var, right_el, data->row_size));
+   ARRAY_ELEMENT *left_el = (ARRAY_ELEMENT*)left;
+   ARRAY_ELEMENT *right_el = (ARRAY_ELEMENT*)right;
+   assert(EXECUTION_SUCCESS == sort_fill_row_array(data->left_var, left_el, data->row_size, data->projection, &data->left_buffers));
+   assert(EXECUTION_SUCCESS == sort_fill_row_array(data->right_var, right_el, data->row_size, data->projection, &data->right_buffers));
 
-   invoke_shell_function_word_list(data->func_var, data->args);
+   invoke_prepared_function(data->callback);
 
    int compval = 0;
    get_int_from_string(&compval, data->return_var->value);
@@ -53,7 +71,265 @@ int pwla_sort_qsort_callback(const void *left, const void *right, void *arg)
 }
 
 /**
- * @brief Create new handle with rows sorted via qsort
+ * @brief Install sorted head in a new handle or, if no name, in the source handle
+ * @param "handle_var"      [in] handle from which the rows were sorted
+ * @param "new_handle_name" [in] name for the new handle, NULL to sort in place
+ * @param "newhead"         [in] the sorted head
+ * @return EXECUTION_SUCCESS or EXECUTION_FAILURE
+ */
+static int pwla_sort_install_head(SHELL_VAR *handle_var,
+                                  const char *new_handle_name,
+                                  AHEAD *newhead)
+{
+   if (new_handle_name)
+   {
+      SHELL_VAR *new_handle_var = NULL;
+      if (ate_create_handle_with_head(&new_handle_var, new_handle_name, newhead))
+         return EXECUTION_SUCCESS;
+
+      xfree(newhead);
+      ate_register_error("failed to initialize sorted handle, %s.", new_handle_name);
+      return EXECUTION_FAILURE;
+   }
+
+   ate_install_head_in_handle(handle_var, newhead);
+   return EXECUTION_SUCCESS;
+}
+
+/**
+ * @brief Order head rows by sorting their records, then install the head.
+ * @param "handle_var"      [in] handle from which the rows were sorted
+ * @param "new_handle_name" [in] name for the new handle, NULL to sort in place
+ * @param "newhead"         [in] head whose rows are represented by @p records
+ * @param "records"         [in] prepared sort records, one for each row
+ * @param "spec"            [in] specification by which to compare the records
+ * @return EXECUTION_SUCCESS or EXECUTION_FAILURE
+ *
+ * The head is installed or freed, regardless of success or failure.
+ */
+static int pwla_sort_records(SHELL_VAR *handle_var,
+                             const char *new_handle_name,
+                             AHEAD *newhead,
+                             SREC *records,
+                             const SSPEC *spec)
+{
+   int row_count = newhead->row_count;
+
+   // Sort a vector of record pointers
+   SREC **order = (SREC**)xmalloc((row_count ? row_count : 1) * sizeof(SREC*));
+   for (int i=0; i < row_count; ++i)
+      order[i] = &records[i];
+
+   if (!ate_stable_sort((void**)order, row_count, sort_records_sort_callback, (void*)spec))
+   {
+      xfree(order);
+      xfree(newhead);
+      ate_register_unexpected_error("sorting rows");
+      return EXECUTION_FAILURE;
+   }
+
+   for (int i=0; i < row_count; ++i)
+      newhead->rows[i] = order[i]->row;
+
+   xfree(order);
+
+   return pwla_sort_install_head(handle_var, new_handle_name, newhead);
+}
+
+/**
+ * @brief Sort rows by a column specification without a callback function
+ * @param "handle_var"      [in] handle whose rows are to be sorted
+ * @param "sort_spec"       [in] string value of the `-k` option
+ * @param "new_handle_name" [in] name for the new handle, NULL to sort in place
+ * @param "collate"         [in] True to collate all string columns (`-l` option)
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int pwla_sort_by_spec(SHELL_VAR *handle_var,
+                             const char *sort_spec,
+                             const char *new_handle_name,
+                             bool collate)
+{
+   int retval;
+   AHEAD *source_head = ahead_cell(handle_var);
+
+   SSPEC *spec = NULL;
+   if ((retval = sort_spec_parse(&spec, sort_spec, source_head->row_size, "sort")))
+      goto early_exit;
+
+   if (collate)
+      for (int i=0; i < spec->count; ++i)
+         spec->columns[i].collate = True;
+
+   retval = EXECUTION_FAILURE;
+
+   AHEAD *newhead = NULL;
+   if (!ate_create_indexed_head(&newhead, source_head->array, source_head->row_size))
+   {
+      ate_register_error("failed to create indexed head for handle '%s'", handle_var->name);
+      goto discard_spec;
+   }
+
+   // Remember the order so later rows can be merged (merge_new_rows)
+   if (!sort_order_append(&newhead,
+                          source_head->array,
+                          newhead->row_count,
+                          SORDER_TABLE_ROWS,
+                          spec,
+                          NULL,
+                          NULL))
+   {
+      ate_register_unexpected_error("recording the sort order");
+      xfree(newhead);
+      goto discard_spec;
+   }
+
+   SREC *records = NULL;
+   if (!sort_records_create(&records, newhead, spec))
+   {
+      ate_register_unexpected_error("preparing rows for sorting");
+      xfree(newhead);
+      goto discard_spec;
+   }
+
+   retval = pwla_sort_records(handle_var, new_handle_name, newhead, records, spec);
+   xfree(records);
+
+  discard_spec:
+   xfree(spec);
+
+  early_exit:
+   return retval;
+}
+
+/**
+ * @brief Sort rows by keys computed once per row by a shell function
+ *
+ * This is the decorate-sort-undecorate pattern: the key function is
+ * invoked exactly once for each row, its results are saved, and the
+ * rows are then sorted by comparing the saved keys as strings.
+ *
+ * Collated keys are saved as their `strxfrm` transformations.
+ *
+ * @param "handle_var"      [in] handle whose rows are to be sorted
+ * @param "function_name"   [in] name of the key function (`-K` option)
+ * @param "new_handle_name" [in] name for the new handle, NULL to sort in place
+ * @param "extra"           [in] extra arguments to pass to the key function
+ * @param "collate"         [in] True to compare keys by locale (`-l` option)
+ * @param "projection"      [in] columns to pass to the key function, or
+ *                               NULL for entire rows (`-p` option)
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int pwla_sort_by_key_function(SHELL_VAR *handle_var,
+                                     const char *function_name,
+                                     const char *new_handle_name,
+                                     ARG_LIST *extra,
+                                     bool collate,
+                                     RPROJ *projection)
+{
+   int retval;
+   AHEAD *source_head = ahead_cell(handle_var);
+
+   // Checked on early exit, must be initialized:
+   SHELL_VAR *cb_return = NULL, *cb_row = NULL;
+   AHEAD *newhead = NULL;
+   SREC *records = NULL;
+   int keys_saved = 0;
+   PREPFUNC callback;
+   memset(&callback, 0, sizeof(callback));
+   RBUFS row_buffers;
+   memset(&row_buffers, 0, sizeof(row_buffers));
+
+   SHELL_VAR *function_var = NULL;
+   if ((retval = get_function_by_name_or_fail(&function_var,
+                                              function_name,
+                                              "sort")))
+      goto early_exit;
+
+   const char *stem = "QSORT_KEY_STEM_";
+   if ((retval = create_var_by_stem(&cb_return, stem, "sort")))
+      goto early_exit;
+   if ((retval = create_array_var_by_stem(&cb_row, stem, "sort")))
+      goto early_exit;
+
+   retval = EXECUTION_FAILURE;
+
+   if (!ate_create_indexed_head(&newhead, source_head->array, source_head->row_size))
+   {
+      ate_register_error("failed to create indexed head for handle '%s'", handle_var->name);
+      goto early_exit;
+   }
+
+   if (!sort_records_allocate(&records, newhead, 1))
+   {
+      ate_register_unexpected_error("preparing rows for sorting");
+      goto early_exit;
+   }
+
+   // Make WORD_LIST for invoking the key function
+   WORD_LIST *cb_head = NULL, *cb_tail = NULL;
+   WL_APPEND(cb_tail, cb_return->name);
+   cb_head = cb_tail;
+   WL_APPEND(cb_tail, cb_row->name);
+   while (extra)
+   {
+      WL_APPEND(cb_tail, extra->value);
+      extra = extra->next;
+   }
+   prepare_shell_function(&callback, function_var, cb_head);
+
+   // Decorate each row with the key returned by the key function
+   SREC *rec = records;
+   SREC *rec_end = rec + newhead->row_count;
+   while (rec < rec_end)
+   {
+      if ((retval = sort_fill_row_array(cb_row, rec->row, newhead->row_size, projection, &row_buffers)))
+         goto early_exit;
+
+      invoke_prepared_function(&callback);
+
+      const char *key = cb_return->value;
+      if (key == NULL)
+         key = "";
+      rec->values->str = collate ? sort_collation_key(key) : savestring(key);
+      ++keys_saved;
+
+      ++rec;
+   }
+
+   // Saved keys are compared as a single string column:
+   SSPEC *spec = (SSPEC*)alloca(sizeof(SSPEC) + sizeof(SCOL));
+   spec->count = 1;
+   spec->columns[0].column = 0;
+   spec->columns[0].source = 0;
+   spec->columns[0].numeric = False;
+   spec->columns[0].reverse = False;
+   spec->columns[0].collate = collate;
+
+   retval = pwla_sort_records(handle_var, new_handle_name, newhead, records, spec);
+   // Installed or discarded, the head is no longer ours to free
+   newhead = NULL;
+
+  early_exit:
+   if (records)
+   {
+      for (int i=0; i < keys_saved; ++i)
+         xfree((char*)records[i].values->str);
+      xfree(records);
+   }
+   if (newhead)
+      xfree(newhead);
+   if (cb_return)
+      unbind_variable(cb_return->name);
+   if (cb_row)
+      unbind_variable(cb_row->name);
+   row_buffers_release(&row_buffers);
+   release_prepared_function(&callback);
+
+   return retval;
+}
+
+/**
+ * @brief Create new handle with rows in a stable sorted order
  * @param "alist"   Stack-based simple linked list of argument values
  * @return EXECUTION_SUCCESS or one of the failure codes
  *
@@ -64,6 +340,10 @@ int pwla_sort(ARG_LIST *alist)
    const char *handle_name = NULL;
    const char *callback_name = NULL;
    const char *new_handle_name = NULL;
+   const char *sort_spec = NULL;
+   const char *key_function_name = NULL;
+   const char *collate_flag = NULL;
+   const char *projection_str = NULL;
 
    ARG_TARGET sort_targets[] = {
       { "handle_name", AL_ARG, &handle_name},
@@ -72,13 +352,51 @@ int pwla_sort(ARG_LIST *alist)
       { NULL }
    };
 
+   ARG_TARGET sort_option_targets[] = {
+      { "handle_name", AL_ARG, &handle_name},
+      { "k", AL_OPT, &sort_spec},
+      { "K", AL_OPT, &key_function_name},
+      { "l", AL_FLAG, &collate_flag},
+      { "p", AL_OPT, &projection_str},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { NULL }
+   };
+
    int retval;
 
    // The following must be initialized because their values
    // will be checked for non-NULL upon an early exit
    SHELL_VAR *return_var = NULL, *left_var = NULL, *right_var = NULL;
+   PREPFUNC callback;
+   memset(&callback, 0, sizeof(callback));
+   RPROJ *projection = NULL;
+
+   // Options are only recognized if one immediately follows the
+   // handle name, and only until the last argument is filled, so
+   // extra arguments meant for the comparison or key function are
+   // never mistaken for options.
+   const char *second_arg = (alist->next && alist->next->next)
+      ? alist->next->next->value : NULL;
 
-   if ((retval = process_word_list_args(sort_targets, alist, AL_NO_OPTIONS)))
+   if (second_arg && second_arg[0] == '-' && 0 != strcmp(second_arg, "--"))
+   {
+      if ((retval = process_word_list_args(sort_option_targets, alist, AL_ARGS_END_OPTIONS)))
+         goto early_exit;
+
+      // Without -k or -K, the options are for a comparison function,
+      // named where the option form expects the new handle name.
+      if (!sort_spec && !key_function_name)
+      {
+         callback_name = new_handle_name;
+         new_handle_name = NULL;
+         if (alist->next)
+         {
+            new_handle_name = alist->next->value;
+            alist->next = alist->next->next;
+         }
+      }
+   }
+   else if ((retval = process_word_list_args(sort_targets, alist, AL_NO_OPTIONS)))
        goto early_exit;
 
    // Ignore a new handle name of --, which holds the argument
@@ -88,10 +406,61 @@ int pwla_sort(ARG_LIST *alist)
       new_handle_name=NULL;
 
    SHELL_VAR *handle_var = NULL;
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "sort")))
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "sort")))
+      goto early_exit;
+
+   if (sort_spec && key_function_name)
+   {
+      ate_register_error("options -k and -K cannot be combined in 'sort'");
+      retval = EX_USAGE;
       goto early_exit;
+   }
+
+   if (collate_flag && !sort_spec && !key_function_name)
+   {
+      ate_register_error("option -l requires option -k or -K in 'sort'");
+      retval = EX_USAGE;
+      goto early_exit;
+   }
+
+   if (projection_str)
+   {
+      if (sort_spec)
+      {
+         ate_register_error("options -k and -p cannot be combined in 'sort'");
+         retval = EX_USAGE;
+         goto early_exit;
+      }
+
+      AHEAD *handle_head = ahead_cell(handle_var);
+      if ((retval = row_projection_parse(&projection,
+                                         projection_str,
+                                         handle_head->row_size,
+                                         "sort")))
+         goto early_exit;
+   }
+
+   if (sort_spec)
+   {
+      retval = pwla_sort_by_spec(handle_var,
+                                 sort_spec,
+                                 new_handle_name,
+                                 collate_flag != NULL);
+      goto early_exit;
+   }
+
+   if (key_function_name)
+   {
+      retval = pwla_sort_by_key_function(handle_var,
+                                         key_function_name,
+                                         new_handle_name,
+                                         alist->next,
+                                         collate_flag != NULL,
+                                         projection);
+      goto early_exit;
+   }
 
    SHELL_VAR *function_var = NULL;
    if ((retval = get_function_by_name_or_fail(&function_var,
@@ -107,7 +476,7 @@ int pwla_sort(ARG_LIST *alist)
    if ((retval = create_array_var_by_stem(&right_var, stem, "sort")))
       goto early_exit;
 
-   // Prepare a copy of the function arguments for the qsort callback to use
+   // Prepare a copy of the function arguments for the sort callback to use
    WORD_LIST *cb_args = NULL, *args_tail = NULL;
    WL_APPEND(args_tail, return_var->name);
    cb_args = args_tail;
@@ -119,41 +488,33 @@ int pwla_sort(ARG_LIST *alist)
       WL_APPEND(args_tail, ptr->value);
       ptr = ptr->next;
    }
+   prepare_shell_function(&callback, function_var, cb_args);
 
    AHEAD *source_head = ahead_cell(handle_var);
 
    struct sort_data pkg = {
       source_head->row_size,
-      function_var,
+      &callback,
       return_var,
       left_var,
       right_var,
-      cb_args
+      projection
    };
 
    AHEAD *newhead = NULL;
    if (ate_create_indexed_head(&newhead, source_head->array, source_head->row_size))
    {
-      qsort_r(&newhead->rows,
-              newhead->row_count,
-              sizeof(ARRAY_ELEMENT*),
-              pwla_sort_qsort_callback,
-              (void*)&pkg);
-
-      if (new_handle_name)
+      if (ate_stable_sort((void**)newhead->rows,
+                          newhead->row_count,
+                          pwla_sort_callback,
+                          (void*)&pkg))
+         retval = pwla_sort_install_head(handle_var, new_handle_name, newhead);
+      else
       {
-         SHELL_VAR *new_handle_var = NULL;
-         if (ate_create_handle_with_head(&new_handle_var, new_handle_name, newhead))
-            retval = EXECUTION_SUCCESS;
-         else
-         {
-            xfree(newhead);
-            ate_register_error("failed to initialize sorted handle, %s.", new_handle_name);
-            retval = EXECUTION_FAILURE;
-         }
+         xfree(newhead);
+         ate_register_unexpected_error("sorting rows");
+         retval = EXECUTION_FAILURE;
       }
-      else
-         ate_install_head_in_handle(handle_var, newhead);
    }
    else
    {
@@ -161,6 +522,9 @@ int pwla_sort(ARG_LIST *alist)
       retval = EXECUTION_FAILURE;
    }
 
+   row_buffers_release(&pkg.left_buffers);
+   row_buffers_release(&pkg.right_buffers);
+
   early_exit:
    if (return_var)
       unbind_variable(return_var->name);
@@ -168,6 +532,9 @@ int pwla_sort(ARG_LIST *alist)
       unbind_variable(left_var->name);
    if (right_var)
       unbind_variable(right_var->name);
+   release_prepared_function(&callback);
+   if (projection)
+      xfree(projection);
 
    return retval;
 }
@@ -0,0 +1,246 @@
+/**
+ * @file pwla_top_k.c
+ * @brief `top_k` action implementation with bounded heap support functions
+ */
+
+#include "pwla.h"
+
+#include <stdio.h>
+
+#include "ate_handle.h"
+#include "ate_utilities.h"
+#include "ate_errors.h"
+#include "ate_sort.h"
+
+/**
+ * @brief Compare records, breaking ties by table position so that
+ *        earlier rows are preferred when keys are equal.
+ * @return <0 if @p left goes before @p right, >0 if after.  Distinct
+ *         records are never equal.
+ */
+static int top_k_compare(const SREC *left, const SREC *right, const SSPEC *spec)
+{
+   int comp = sort_records_compare(left, right, spec);
+   if (comp == 0)
+      comp = (left > right) - (left < right);
+   return comp;
+}
+
+/**
+ * @brief Restore the heap order from @p index down, keeping the record
+ *        that sorts last at the top of the heap.
+ */
+static void top_k_sift_down(SREC **heap, int count, int index, const SSPEC *spec)
+{
+   SREC *rec = heap[index];
+   while (1)
+   {
+      int child = 2 * index + 1;
+      if (child >= count)
+         break;
+
+      if (child + 1 < count && top_k_compare(heap[child+1], heap[child], spec) > 0)
+         ++child;
+
+      if (top_k_compare(heap[child], rec, spec) <= 0)
+         break;
+
+      heap[index] = heap[child];
+      index = child;
+   }
+   heap[index] = rec;
+}
+
+/**
+ * @brief Restore the heap order from @p index up.
+ */
+static void top_k_sift_up(SREC **heap, int index, const SSPEC *spec)
+{
+   SREC *rec = heap[index];
+   while (index > 0)
+   {
+      int parent = (index - 1) / 2;
+      if (top_k_compare(heap[parent], rec, spec) >= 0)
+         break;
+
+      heap[index] = heap[parent];
+      index = parent;
+   }
+   heap[index] = rec;
+}
+
+/**
+ * @brief Select, in order, the first @p limit records of a sort order.
+ *
+ * A heap of at most @p limit records holds the best records found so
+ * far, with the worst of them at the top to be replaced by any better
+ * record.  Selecting from N records takes O(N log limit) comparisons.
+ *
+ * @param "selected" [out] array of at least @p limit elements to
+ *                         receive the selected records in order
+ * @param "records"  [in]  records from which to select
+ * @param "count"    [in]  number of @p records
+ * @param "limit"    [in]  maximum number of records to select
+ * @param "spec"     [in]  the specification that prepared the records
+ * @return number of records selected
+ */
+static int top_k_select(SREC **selected,
+                        SREC *records,
+                        int count,
+                        int limit,
+                        const SSPEC *spec)
+{
+   int heap_count = 0;
+
+   SREC *rec = records;
+   SREC *rec_end = rec + count;
+   while (rec < rec_end)
+   {
+      if (heap_count < limit)
+      {
+         selected[heap_count] = rec;
+         top_k_sift_up(selected, heap_count, spec);
+         ++heap_count;
+      }
+      else if (top_k_compare(rec, selected[0], spec) < 0)
+      {
+         selected[0] = rec;
+         top_k_sift_down(selected, heap_count, 0, spec);
+      }
+
+      ++rec;
+   }
+
+   // Heap sort: move the last-sorting record to the end of the array
+   for (int end = heap_count - 1; end > 0; --end)
+   {
+      SREC *top = selected[0];
+      selected[0] = selected[end];
+      selected[end] = top;
+      top_k_sift_down(selected, end, 0, spec);
+   }
+
+   return heap_count;
+}
+
+/**
+ * @brief Create new handle with only the first rows of a sort order
+ * @param "alist"   Stack-based simple linked list of argument values
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ *
+ * see man ate(1)
+ */
+int pwla_top_k(ARG_LIST *alist)
+{
+   const char *handle_name = NULL;
+   const char *new_handle_name = NULL;
+   const char *sort_spec = NULL;
+   const char *limit_str = NULL;
+
+   ARG_TARGET top_k_targets[] = {
+      { "handle_name",     AL_ARG, &handle_name},
+      { "new_handle_name", AL_ARG, &new_handle_name},
+      { "k",               AL_OPT, &sort_spec},
+      { "n",               AL_OPT, &limit_str},
+      { NULL }
+   };
+
+   int retval;
+
+   // Checked on early exit, must be initialized
+   SSPEC *spec = NULL;
+   SREC *records = NULL;
+   AHEAD *table_head = NULL;
+
+   if ((retval = process_word_list_args(top_k_targets, alist, 0)))
+       goto early_exit;
+
+   SHELL_VAR *handle_var;
+   if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                      handle_name,
+                                                      "top_k")))
+      goto early_exit;
+
+   retval = EX_USAGE;
+
+   if (new_handle_name == NULL)
+   {
+      ate_register_missing_argument("new_handle_name", "top_k");
+      goto early_exit;
+   }
+
+   AHEAD *ahead = ahead_cell(handle_var);
+
+   int limit = 0;
+   if (limit_str == NULL)
+   {
+      ate_register_missing_argument("-n row_limit", "top_k");
+      goto early_exit;
+   }
+   else if (get_int_from_string(&limit, limit_str))
+   {
+      if (limit < 1)
+      {
+         ate_register_error("invalid row limit %d in action 'top_k'", limit);
+         goto early_exit;
+      }
+   }
+   else
+   {
+      ate_register_not_an_int(limit_str, "top_k");
+      goto early_exit;
+   }
+
+   if ((retval = sort_spec_parse(&spec, sort_spec, ahead->row_size, "top_k")))
+      goto early_exit;
+
+   retval = EXECUTION_FAILURE;
+
+   // Select from every row of the table, as `sort -k` orders them,
+   // so the result matches the first rows of a sort of the same handle.
+   if (!ate_create_indexed_head(&table_head, ahead->array, ahead->row_size))
+      goto early_exit;
+
+   if (limit > table_head->row_count)
+      limit = table_head->row_count;
+
+   if (!sort_records_create(&records, table_head, spec))
+   {
+      ate_register_unexpected_error("preparing rows for sorting");
+      goto early_exit;
+   }
+
+   SREC **selected = (SREC**)xmalloc((limit ? limit : 1) * sizeof(SREC*));
+   int count = top_k_select(selected, records, table_head->row_count, limit, spec);
+
+   AHEAD *new_head = (AHEAD*)xmalloc(ate_calculate_head_size(count));
+   if (ate_initialize_head(new_head, ahead->array, ahead->row_size))
+   {
+      for (int i=0; i < count; ++i)
+         new_head->rows[i] = selected[i]->row;
+      new_head->row_count = count;
+
+      SHELL_VAR *new_handle_var = NULL;
+      if (ate_create_handle_with_head(&new_handle_var, new_handle_name, new_head))
+         retval = EXECUTION_SUCCESS;
+      else
+         xfree(new_head);
+   }
+   else
+   {
+      ate_register_unexpected_error("initializing the top_k handle");
+      xfree(new_head);
+   }
+
+   xfree(selected);
+
+  early_exit:
+   if (records)
+      xfree(records);
+   if (table_head)
+      xfree(table_head);
+   if (spec)
+      xfree(spec);
+
+   return retval;
+}
@@ -10,6 +10,128 @@
 
 #include "word_list_stack.h"
 
+/**
+ * @brief The current row of a walk, to be copied to the callback's
+ *        row array.
+ */
+typedef struct row_view {
+   SHELL_VAR        *var;        ///< the callback's row array
+   const AHEAD      *key_head;   ///< native key being walked directly, or NULL
+   ARRAY_ELEMENT    *row;        ///< current row
+   int              row_index;   ///< index of the current row in @p key_head
+   int              row_size;    ///< number of fields to copy
+   RPROJ            *projection; ///< columns to copy, or NULL for all
+   RBUFS            buffers;     ///< buffers of the row array's elements
+   bool             filled;      ///< True once the current row is copied
+   int              status;      ///< result of copying the current row
+   struct row_view  *outer;      ///< lazy view of an enclosing walk
+} ROWVIEW;
+
+/**
+ * @brief Copy the current row of a view to its row array
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int row_view_fill(ROWVIEW *view)
+{
+   if (view->key_head)
+      view->status = update_head_row_array(view->var, view->key_head, view->row_index, &view->buffers);
+   else if (view->projection)
+      view->status = update_projected_row_array(view->var, view->row, view->projection, &view->buffers);
+   else
+      view->status = update_row_array(view->var, view->row, view->row_size, &view->buffers);
+
+   view->filled = True;
+   return view->status;
+}
+
+/**
+ * @brief Lazy views (-L) of the walks in progress, innermost first,
+ *        for a callback that calls `walk_rows` in turn.
+ */
+static ROWVIEW *lazy_views = NULL;
+
+/**
+ * @brief Value function of a lazy row array
+ *
+ * Bash calls a variable's `dynamic_value` function whenever the
+ * variable is looked up, so the row is copied the first time the
+ * callback refers to the row array, and not at all if it doesn't.
+ * Later lookups for the same row keep any changes made by the
+ * callback, for example before calling `put_row`.
+ */
+static SHELL_VAR *row_view_value(SHELL_VAR *var)
+{
+   for (ROWVIEW *view = lazy_views; view; view = view->outer)
+   {
+      if (view->var == var)
+      {
+         if (!view->filled)
+            row_view_fill(view);
+         break;
+      }
+   }
+
+   return var;
+}
+
+/**
+ * @brief Append a row to the flattened rows of a batch
+ * @param "array"     [in,out] batch array, flushed at the start of the batch
+ * @param "position"  [in]     index of the first field of the row
+ * @param "head"      [in]     handle being walked
+ * @param "row"       [in]     row to copy
+ * @param "row_size"  [in]     number of fields to copy
+ * @param "key_row"   [in]     if not negative, the native key row whose
+ *                             value and row index are to be copied
+ * @param "projection" [in]    if not NULL, the columns to copy
+ * @return EXECUTION_SUCCESS or one of the failure codes
+ */
+static int append_batch_row(ARRAY *array,
+                            int position,
+                            const AHEAD *head,
+                            ARRAY_ELEMENT *row,
+                            int row_size,
+                            int key_row,
+                            RPROJ *projection)
+{
+   if (key_row >= 0)
+   {
+      char number_buffer[32];
+      snprintf(number_buffer, sizeof(number_buffer), "%d", head->key_rows[key_row]);
+      array_insert(array, position, head->rows[key_row]->value);
+      array_insert(array, position + 1, number_buffer);
+      return EXECUTION_SUCCESS;
+   }
+
+   if (projection)
+   {
+      if (!row_projection_gather(projection, row))
+      {
+         ate_register_error("corrupted table: incomplete row");
+         return EX_USAGE;
+      }
+
+      for (int i=0; i < projection->count; ++i)
+         array_insert(array, position + i, projection->fields[projection->columns[i]]->value);
+
+      return EXECUTION_SUCCESS;
+   }
+
+   int index = 0;
+   while (row && index < row_size)
+   {
+      array_insert(array, position + index++, row->value);
+      row = row->next;
+   }
+
+   if (index < row_size)
+   {
+      ate_register_error("corrupted table: incomplete row");
+      return EX_USAGE;
+   }
+
+   return EXECUTION_SUCCESS;
+}
 
 /**
  * @brief Sends each row to a callback function
@@ -25,6 +147,9 @@ int pwla_walk_rows(ARG_LIST *alist)
    const char *key_handle_name = NULL;
    const char *start_ndx_str = NULL;
    const char *count_rows_str = NULL;
+   const char *batch_size_str = NULL;
+   const char *projection_str = NULL;
+   const char *lazy_flag = NULL;
 
    ARG_TARGET walk_rows_targets[] = {
       { "handle_name",   AL_ARG, &handle_name},
@@ -32,29 +157,44 @@ int pwla_walk_rows(ARG_LIST *alist)
       { "k"            , AL_OPT, &key_handle_name},
       { "s"            , AL_OPT, &start_ndx_str},
       { "c"            , AL_OPT, &count_rows_str},
+      { "b"            , AL_OPT, &batch_size_str},
+      { "p"            , AL_OPT, &projection_str},
+      { "L"            , AL_FLAG, &lazy_flag},
       { NULL }
    };
 
    int retval;
 
+   // Checked on early exit, must be initialized
+   PREPFUNC callback;
+   memset(&callback, 0, sizeof(callback));
+   RPROJ *projection = NULL;
+   ROWVIEW view;
+   memset(&view, 0, sizeof(view));
+
    if ((retval = process_word_list_args(walk_rows_targets, alist, 0)))
        goto early_exit;
 
    SHELL_VAR *handle_key_var = NULL;
    SHELL_VAR *handle_var = NULL;
 
-   if ((retval = get_handle_var_by_name_or_fail(&handle_var,
-                                                handle_name,
-                                                "walk_rows")))
-      goto early_exit;
-
    if (key_handle_name)
    {
+      // Only a table can supply the rows for a separate key
+      if ((retval = get_table_handle_var_by_name_or_fail(&handle_var,
+                                                         handle_name,
+                                                         "walk_rows")))
+         goto early_exit;
+
       if ((retval = get_handle_var_by_name_or_fail(&handle_key_var,
                                                    key_handle_name,
                                                    "walk_rows")))
          goto early_exit;
    }
+   else if ((retval = get_handle_var_by_name_or_fail(&handle_var,
+                                                     handle_name,
+                                                     "walk_rows")))
+      goto early_exit;
 
 
    AHEAD *walker_ahead = NULL, *data_ahead = NULL;
@@ -88,7 +228,8 @@ int pwla_walk_rows(ARG_LIST *alist)
    {
       if (get_int_from_string(&start_ndx, start_ndx_str))
       {
-         if (start_ndx < 0 || start_ndx >= walker_ahead->row_count)
+         // Starting at the row count walks no rows, like an empty range
+         if (start_ndx < 0 || start_ndx > walker_ahead->row_count)
          {
             ate_register_invalid_row_index(start_ndx, walker_ahead->row_count);
             goto early_exit;
@@ -110,6 +251,54 @@ int pwla_walk_rows(ARG_LIST *alist)
       }
    }
 
+   int batch_size = 0;
+   if (batch_size_str)
+   {
+      if (! get_int_from_string(&batch_size, batch_size_str))
+      {
+         ate_register_not_an_int(batch_size_str, "walk_rows");
+         goto early_exit;
+      }
+
+      if (batch_size < 1)
+      {
+         ate_register_error("batch size %d must be at least 1 for 'walk_rows'", batch_size);
+         goto early_exit;
+      }
+   }
+
+   int data_row_size = data_ahead ? data_ahead->row_size : walker_ahead->row_size;
+
+   if (projection_str)
+   {
+      if (!data_ahead && walker_ahead->key_rows)
+      {
+         ate_register_error("option -p cannot be used to walk native key '%s'", handle_name);
+         goto early_exit;
+      }
+
+      if ((retval = row_projection_parse(&projection, projection_str, data_row_size, "walk_rows")))
+         goto early_exit;
+
+      retval = EX_USAGE;
+   }
+
+   if (lazy_flag && batch_size)
+   {
+      ate_register_error("options -b and -L cannot be combined in 'walk_rows'");
+      goto early_exit;
+   }
+
+   // A batch has a second array for the row indexes
+   SHELL_VAR *index_var = NULL;
+   if (batch_size)
+   {
+      if ((retval = create_array_var_by_stem(&index_var, "ATE_WALKING_INDEXES_", "walk_rows")))
+         goto early_exit;
+
+      retval = EX_USAGE;
+   }
+
    // Fix overreach
    if (start_ndx + count_rows > walker_ahead->row_count)
       count_rows = walker_ahead->row_count - start_ndx;
@@ -121,16 +310,25 @@ int pwla_walk_rows(ARG_LIST *alist)
    WL_APPEND(cb_tail, array_var->name);
    cb_args = cb_tail;
 
-   // #2 argument is row_index
-   // setup row_index WORD_DESC with a buffer we can change each iteration:
+   // #2 argument is row_index, or the name of the row indexes array
+   // of a batch.  Setup row_index WORD_DESC with a buffer we can change
+   // each iteration:
    char row_number_buffer[32];
-   WL_APPEND(cb_tail, "");
-   cb_tail->word->word = row_number_buffer;
+   if (index_var)
+   {
+      WL_APPEND(cb_tail, index_var->name);
+   }
+   else
+   {
+      WL_APPEND(cb_tail, "");
+      cb_tail->word->word = row_number_buffer;
+   }
 
    // #3 argument is the source handle's name
    WL_APPEND(cb_tail, handle_name);
 
-   // #4 argument is order index, may be same as row_index:
+   // #4 argument is order index, may be same as row_index.  For a
+   // batch, it is the order index of the first row of the batch:
    char order_number_buffer[32];
    WL_APPEND(cb_tail, "");
    cb_tail->word->word = order_number_buffer;
@@ -143,6 +341,8 @@ int pwla_walk_rows(ARG_LIST *alist)
       extra = extra->next;
    }
 
+   prepare_shell_function(&callback, function_var, cb_args);
+
    ARRAY_ELEMENT **ae_ptr = &walker_ahead->rows[start_ndx];
    ARRAY_ELEMENT **ae_end = ae_ptr + count_rows;
 
@@ -150,13 +350,44 @@ int pwla_walk_rows(ARG_LIST *alist)
    int row_ndx, order_ndx, cur_ndx = start_ndx;
    ARRAY_ELEMENT *ae_row;
 
-   int data_row_size = data_ahead ? data_ahead->row_size : walker_ahead->row_size;
+   // Rows in the current batch
+   int batch_count = 0;
+   ARRAY *batch_rows = array_cell(array_var);
+   ARRAY *batch_indexes = index_var ? array_cell(index_var) : NULL;
+   int batch_row_size = (!data_ahead && walker_ahead->key_rows) ? 2 : data_row_size;
+   if (projection)
+      batch_row_size = projection->count;
+
+   view.var = array_var;
+   view.key_head = (!data_ahead && walker_ahead->key_rows) ? walker_ahead : NULL;
+   view.row_size = data_row_size;
+   view.projection = projection;
+
+   // A lazy row array is filled by its value function
+   if (lazy_flag)
+   {
+      view.outer = lazy_views;
+      lazy_views = &view;
+      array_var->dynamic_value = row_view_value;
+   }
 
    while (ae_ptr < ae_end)
    {
-      if (data_ahead)
+      if (data_ahead && walker_ahead->key_rows)
+      {
+         // A native key keeps its row indexes as integers
+         order_ndx = cur_ndx;
+         row_ndx = walker_ahead->key_rows[cur_ndx];
+         ae_row = data_ahead->rows[row_ndx];
+      }
+      else if (data_ahead)
       {
-         const char *ndx_str = (*ae_ptr)->next->value;
+         // The row index is the last field of a key row, after one
+         // or more key values
+         ARRAY_ELEMENT *ndx_el = *ae_ptr;
+         for (int field_index=1; field_index < walker_ahead->row_size; ++field_index)
+            ndx_el = ndx_el->next;
+         const char *ndx_str = ndx_el->value;
 
          // In ordered-walk, we'll need to
          // set both indexes individually:
@@ -178,25 +409,75 @@ int pwla_walk_rows(ARG_LIST *alist)
 
       // For next iteration
       ++cur_ndx;
+      ++ae_ptr;
+
+      if (batch_size)
+      {
+         if (batch_count == 0)
+         {
+            array_flush(batch_rows);
+            array_flush(batch_indexes);
+            snprintf(order_number_buffer, sizeof(order_number_buffer), "%d", order_ndx);
+         }
+
+         if ((retval = append_batch_row(batch_rows,
+                                        batch_count * batch_row_size,
+                                        walker_ahead,
+                                        ae_row,
+                                        batch_row_size,
+                                        (!data_ahead && walker_ahead->key_rows) ? row_ndx : -1,
+                                        projection)))
+            goto early_exit;
+
+         snprintf(row_number_buffer, sizeof(row_number_buffer), "%d", row_ndx);
+         array_insert(batch_indexes, batch_count, row_number_buffer);
+
+         // Call the callback when the batch is full or the rows run out
+         if (++batch_count < batch_size && ae_ptr < ae_end)
+            continue;
+
+         batch_count = 0;
+         if ((0 != invoke_prepared_function(&callback)))
+            goto early_exit;
+
+         continue;
+      }
 
       // Setup row_index and order_index WORD_DESC values for this iteration
       snprintf(row_number_buffer, sizeof(row_number_buffer), "%d", row_ndx);
       snprintf(order_number_buffer, sizeof(order_number_buffer), "%d", order_ndx);
 
-      // Fill the target row with current row contents
-      if ((retval = update_row_array(array_var, ae_row, data_row_size)))
+      // Fill the target row with current row contents, or leave it
+      // for the value function of a lazy row array
+      view.row = ae_row;
+      view.row_index = row_ndx;
+      view.filled = False;
+      retval = lazy_flag ? EXECUTION_SUCCESS : row_view_fill(&view);
+      if (retval)
          goto early_exit;
 
       // Prepare and call the callback
-      if ((0 != invoke_shell_function_word_list(function_var, cb_args)))
+      int cb_result = invoke_prepared_function(&callback);
+
+      if (view.filled && (retval = view.status))
          goto early_exit;
 
-      ++ae_ptr;
+      if (0 != cb_result)
+         goto early_exit;
    }
 
    retval = EXECUTION_SUCCESS;
 
   early_exit:
+   if (lazy_views == &view)
+   {
+      lazy_views = view.outer;
+      view.var->dynamic_value = NULL;
+   }
+   row_buffers_release(&view.buffers);
+   release_prepared_function(&callback);
+   if (projection)
+      xfree(projection);
    return retval;
 }
 